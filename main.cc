@@ -4,7 +4,8 @@
  * Compiler: gnu++17
  * Libraries: libsdl2-dev libsdl2-ttf-dev
  * Sysytem: Linux
- * Build: -g ./main.cc -lSDL2 -lSDL2main -lSDL2_ttf -std=c++17 -o main
+ * Build: -g ./main.cc -lSDL2 -lSDL2main -lSDL2_ttf -std=c++17 -pthread -o main
+ * Benchmark: -O2 ./main.cc -DBENCHMARK -std=c++17 -pthread -o benchmark
  * Date: Mar 26, 2023
  * Time: 3.20am
  * 
@@ -14,16 +15,44 @@
  * https://github.com/ngmsoftware/hashlife
  */
 
+#ifdef BENCHMARK
+#define HEADLESS                        // The suite never opens a window
+#endif
+
+#ifndef HEADLESS
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL.h>
+#endif
 #include <assert.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <math.h>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <limits>
+#include <chrono>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <string>
 #include <deque>
 #include <map>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 
 using std::map;
 using std::cout;
@@ -36,29 +65,8 @@ using std::stringstream;
 
 #define WIDTH 960
 #define HEIGHT 720
-const string ZERO = "0", ONE = "1";
 const int P_VERTICAL = 0, P_HORIZONTAL = 1;
 
-typedef deque<string> grid1D;
-typedef deque<deque<string>> grid2D;
-
-grid1D NewGrid1D(int l) {
-    grid1D zeroes;
-    for (int x = 0; x < l; x++)
-        zeroes.push_back(ZERO);
-    return zeroes;
-}
-
-grid2D NewGrid2D(int h, int w) {
-    grid2D grid; grid1D zeroes;
-    for (int x = 0; x < w; x++)
-        zeroes.push_back(ZERO);
-    for (int y = 0; y < h; y++)
-        grid.push_back(zeroes);
-    return grid;
-}
-
-
 template <typename int_t = int>
 struct Vector2D {
     int_t x, y;
@@ -73,47 +81,6 @@ struct Vector2D {
     }
 };
 
-void PrintArray(const grid2D &vx) {
-    for (const auto &y : vx) {
-        for (const auto &x : y)
-            cout << x << " ";
-        cout << endl;
-    }
-}
-
-grid2D vx_rot90(grid2D &vx) {
-    grid2D result;
-    for (int x = 0; x < vx[0].size(); x++) {
-        deque<string> row;
-        for (int y = vx.size() - 1; y >= 0; y--) {
-            row.push_back(vx[y][x]);
-        }
-        result.push_back(row);
-    }
-    return result;
-}
-
-grid2D vx_flip(grid2D &vx, int flip) {
-    grid2D result;
-    if (flip == P_VERTICAL) {
-        for (int y = vx.size() - 1; y >= 0; y--) {
-            result.push_back(vx[y]);
-        }
-    }
-    else if (flip == P_HORIZONTAL) {
-        for (int y = 0; y < vx.size(); y++)
-        {
-            deque<string> row;
-            for (int x = vx[0].size(); x >= 0; x--) {
-                row.push_back(vx[y][x]);
-            }
-            result.push_back(row);
-        }
-    }
-    else throw std::invalid_argument("Flip must be -1, 0, or 1.");
-    return result;
-}
-
 string str_trim(string &str) {
     if (str == "")
         return str;
@@ -151,11 +118,156 @@ deque<string> str_split(string &str, string delim) {
     return result;
 }
 
-namespace ReadPattern {
-    map<string, grid2D> cache = {};
-    const map<char, int> STREAM = {
-        {'.', 0}, {'O', 1}};
+// Scoped timers and counters on the hot paths. They are compiled in with
+// -DPROFILE and cost nothing otherwise. The totals feed the overlay, and
+// --trace <file> also records every timed scope as a Chrome trace event
+// (chrome://tracing or ui.perfetto.dev).
+namespace Profile {
+    typedef std::chrono::steady_clock Clock;
+#ifdef PROFILE
+    const bool ENABLED = true;
+#else
+    const bool ENABLED = false;
+#endif
+
+    // The totals of one timer or counter
+    struct _QProbe_ {
+        const char *name;
+        bool timer;
+        std::atomic<uint64_t> calls{0}, nanos{0};
+        uint64_t lastcalls = 0, lastnanos = 0;  // At the last Rates()
+
+        _QProbe_(const char *_name, bool _timer);
+    };
+
+    // A complete ("X") event, or a counter ("C") when dur is negative
+    struct _QEvent_ {
+        const char *name;
+        int tid;
+        double ts, dur;             // Microseconds since Start
+        double value = 0.;
+    };
+
+    std::mutex Lock;                // Guards the Probes and the Events
+    std::vector<_QProbe_ *> Probes;
+    std::vector<_QEvent_> Events;
+    std::atomic<bool> Tracing{false};
+    const size_t MAX_EVENTS = size_t(1) << 22;  // About 150 MB of events
+    const Clock::time_point Start = Clock::now();
+    std::atomic<int> Threads{0};
+    thread_local int Tid = Threads++;
+
+    _QProbe_::_QProbe_(const char *_name, bool _timer) : name(_name), timer(_timer) {
+        std::lock_guard<std::mutex> guard(Lock);
+        Probes.push_back(this);
+    }
+
+    double Micros(Clock::time_point t) {
+        return std::chrono::duration<double, std::micro>(t - Start).count();
+    }
 
+    void Record(const _QEvent_ &event) {
+        std::lock_guard<std::mutex> guard(Lock);
+        if (Events.size() < MAX_EVENTS) Events.push_back(event);
+    }
+
+    // Times the scope it lives in
+    struct _QTimer_ {
+        _QProbe_ &probe;
+        Clock::time_point start = Clock::now();
+
+        _QTimer_(_QProbe_ &_probe) : probe(_probe) {}
+        ~_QTimer_() {
+            Clock::time_point end = Clock::now();
+            probe.calls.fetch_add(1, std::memory_order_relaxed);
+            probe.nanos.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                end - start).count(), std::memory_order_relaxed);
+            if (Tracing)
+                Record({probe.name, Tid, Micros(start), Micros(end) - Micros(start)});
+        }
+    };
+
+    // Records the value of a counter in the trace
+    void Sample(const char *name, double value) {
+        if (Tracing) Record({name, Tid, Micros(Clock::now()), -1., value});
+    }
+
+    // One line per probe: calls per second, and for a timer the share of
+    // a second and the milliseconds per call, since the last time the
+    // rates were taken at least a second before
+    std::vector<string> Rates() {
+        static Clock::time_point last = Start;
+        static std::vector<string> lines;
+        Clock::time_point now = Clock::now();
+        double seconds = std::chrono::duration<double>(now - last).count();
+        if (seconds < 1.) return lines;
+        last = now;
+        lines.clear();
+        std::lock_guard<std::mutex> guard(Lock);
+        for (_QProbe_ *probe : Probes) {
+            uint64_t calls = probe->calls, nanos = probe->nanos;
+            uint64_t dc = calls - probe->lastcalls, dn = nanos - probe->lastnanos;
+            probe->lastcalls = calls, probe->lastnanos = nanos;
+            stringstream line;
+            line.precision(3);
+            line << probe->name << ": " << dc / seconds << "/s";
+            if (probe->timer && dc) {
+                line << ", " << 100. * dn / (seconds * 1e9) << "%";
+                line << ", " << dn / 1e6 / dc << " ms";
+            }
+            lines.push_back(line.str());
+        }
+        return lines;
+    }
+
+    // Prints the calls of every probe, and the time of every timer
+    void PrintTotals() {
+        std::lock_guard<std::mutex> guard(Lock);
+        for (_QProbe_ *probe : Probes) {
+            cout << "Profile: " << probe->name << " " << probe->calls << " calls";
+            if (probe->timer) cout << ", " << probe->nanos / 1e6 << " ms";
+            cout << endl;
+        }
+    }
+
+    // Writes the recorded events in the Chrome trace event format
+    void WriteTrace(string addr) {
+        std::lock_guard<std::mutex> guard(Lock);
+        std::ofstream file(addr, std::ios::out | std::ios::trunc);
+        if (!file) throw std::invalid_argument("Unable to write " + addr);
+        file << "{\"traceEvents\":[";
+        for (size_t x = 0; x < Events.size(); x++) {
+            const _QEvent_ &e = Events[x];
+            file << (x ? ",\n" : "\n") << "{\"name\":\"" << e.name << "\",\"pid\":1,\"tid\":" << e.tid;
+            file << std::fixed << ",\"ts\":" << e.ts;
+            if (e.dur >= 0.) file << ",\"ph\":\"X\",\"dur\":" << e.dur;
+            else file << ",\"ph\":\"C\",\"args\":{\"" << e.name << "\":" << e.value << "}";
+            file << std::defaultfloat << "}";
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}" << endl;
+        cout << "[trace] wrote " << Events.size() << " events to " << addr << endl;
+    }
+}
+
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+#ifdef PROFILE
+// Times the rest of the enclosing scope
+#define PROFILE_SCOPE(name) \
+    static Profile::_QProbe_ PROFILE_JOIN(_probe_, __LINE__)(name, true); \
+    Profile::_QTimer_ PROFILE_JOIN(_timer_, __LINE__)(PROFILE_JOIN(_probe_, __LINE__))
+// Counts the times it is reached
+#define PROFILE_COUNT(name) \
+    static Profile::_QProbe_ PROFILE_JOIN(_probe_, __LINE__)(name, false); \
+    PROFILE_JOIN(_probe_, __LINE__).calls.fetch_add(1, std::memory_order_relaxed)
+#define PROFILE_SAMPLE(name, value) Profile::Sample(name, value)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(name)
+#define PROFILE_SAMPLE(name, value)
+#endif
+
+namespace ReadPattern {
     deque<string> ReadFile(string addr) {
         string line;
         deque<string> result;
@@ -169,60 +281,173 @@ namespace ReadPattern {
         return result;
     }
 
-    // Reads a pattern from cache and augments it appropriately
-    grid2D read_from_cache(string addr, int angle, int flip) {
-        grid2D pattern = cache[addr];
-        if (angle > 0)
-            pattern = vx_rot90(pattern);
-        if (angle > 90)
-            pattern = vx_rot90(pattern);
-        if (angle > 180)
-            pattern = vx_rot90(pattern);
-        return (flip != -1) ? vx_flip(pattern, flip) : pattern;
+    // Callback for a run of live cells: x, y and the length of the run
+    typedef std::function<void(long int, long int, long int)> CellRun;
+
+    // Tells the format of a pattern file from its first lines:
+    // "life106", "rle" or "plaintext"
+    string PatternFormat(string addr) {
+        string line;
+        std::ifstream file(addr, std::ios::in);
+        while (std::getline(file, line)) {
+            line = str_trim(line);
+            if (line.substr(0, 10) == "#Life 1.06") return "life106";
+            if (line == "" || line[0] == '#' || line[0] == '!') continue;
+            // The first line that is not a comment
+            if (line[0] == 'x' && line.find('=') != string::npos) return "rle";
+            break;
+        }
+        return "plaintext";
     }
 
-    // Reads a pattern from file and saves it to the cache
-    grid2D read_from_dir(string addr, int angle, int flip) {
-        cache[addr] = grid2D(); // Add new entry to the cache
-        auto pattern = ReadFile("./src/" + addr);
-        for (const string &line : pattern) {
-            // Check if line is a comment
-            if (line[0] == '#' || line == "")
-                continue;
-            if (line[0] == '.' || line[0] == 'O')
-            {
-                deque<string> row;
-                for (const char &x : line)
-                {
-                    if (x == '.')
-                        row.push_back(ZERO);
-                    else if (x == 'O')
-                        row.push_back(ONE);
-                    else
-                        throw std::invalid_argument("Unknown char");
+    // Streams the live runs of an RLE file row by row.
+    // Never holds more than a line of the file in memory.
+    void ReadRLE(string addr, const CellRun &run) {
+        string line;
+        long int x = 0, y = 0, count = 0;
+        std::ifstream file(addr, std::ios::in);
+        if (!file) throw std::invalid_argument("Unable to open " + addr);
+        while (std::getline(file, line)) {
+            line = str_trim(line);
+            // Skip comments and the "x = m, y = n, rule = ..." header
+            if (line == "" || line[0] == '#' || line[0] == 'x') continue;
+            for (const char &c : line) {
+                if (isdigit(c)) {
+                    count = count * 10 + (c - '0');
+                    continue;
                 }
-                cache[addr].push_back(row);
+                long int n = (count == 0) ? 1 : count;
+                count = 0;
+                if (c == 'b' || c == '.')
+                    x += n;                 // Dead cells
+                else if (c == '$')
+                    y += n, x = 0;          // End of one or more rows
+                else if (c == '!')
+                    return;                 // End of the pattern
+                else if (isalpha(c) || c == '*') {
+                    run(x, y, n);           // Any other state is alive
+                    x += n;
+                }
+                else if (!isspace(c))
+                    throw std::invalid_argument("Unknown char in RLE");
             }
         }
-        return read_from_cache(addr, angle, flip);
     }
 
-    // Reads returns a pattern
-    grid2D parser_load(string addr, int angle, int flip) {
-        //  Search the cache for preloaded
-        if (cache.find(addr) != cache.end())
-        {
-            return read_from_cache(addr, angle, flip);
+    // Returns the rule of an RLE header, or "" when it has none
+    string ReadRule(string addr) {
+        string line;
+        std::ifstream file(addr, std::ios::in);
+        while (std::getline(file, line)) {
+            line = str_trim(line);
+            if (line == "" || line[0] == '#') continue;
+            if (line[0] != 'x') break;
+            size_t at = line.find("rule");
+            if (at == string::npos) break;
+            string rule = line.substr(line.find('=', at) + 1);
+            // Drop the bounded grid suffix, as in B3/S23:T100,100
+            rule = rule.substr(0, rule.find(':'));
+            return str_trim(rule);
+        }
+        return "";
+    }
+
+    // Reads the cells of a Life 1.06 file, which may come in any order.
+    // They are sorted into rows and moved so the top left cell is 0, 0.
+    void ReadLife106(string addr, const CellRun &run) {
+        string line;
+        std::vector<std::pair<long int, long int>> cells; // (y, x)
+        std::ifstream file(addr, std::ios::in);
+        if (!file) throw std::invalid_argument("Unable to open " + addr);
+        while (std::getline(file, line)) {
+            line = str_trim(line);
+            if (line == "" || line[0] == '#') continue;
+            long int x, y;
+            stringstream cell(line);
+            if (!(cell >> x >> y))
+                throw std::invalid_argument("Bad cell in Life 1.06");
+            cells.push_back({y, x});
+        }
+        if (cells.empty()) return;
+        std::sort(cells.begin(), cells.end());
+        long int minx = cells[0].second, miny = cells[0].first;
+        for (const auto &[y, x] : cells) minx = std::min(minx, x);
+        for (const auto &[y, x] : cells) run(x - minx, y - miny, 1);
+    }
+
+    // Streams the plaintext format, where O or * is alive and . is dead.
+    // Returns the width and the rows of its grid.
+    Vector2D<long int> ReadPlaintext(string addr, const CellRun &run) {
+        string line;
+        Vector2D<long int> size(0, 0);
+        std::ifstream file(addr, std::ios::in);
+        if (!file) throw std::invalid_argument("Unable to open " + addr);
+        while (std::getline(file, line)) {
+            line = str_trim(line);
+            if (line == "" || line[0] == '#' || line[0] == '!') continue;
+            for (long int x = 0; x < line.length(); x++) {
+                if (line[x] == 'O' || line[x] == '*') run(x, size.y, 1);
+                else if (line[x] != '.') throw std::invalid_argument("Unknown char in plaintext");
+            }
+            size.x = std::max<long int>(size.x, line.length());
+            size.y++;
+        }
+        return size;
+    }
+
+    // Streams the live cells of a pattern file in any known format,
+    // in row order and with no negative coordinates
+    void ReadCells(string addr, const CellRun &run) {
+        string format = PatternFormat(addr);
+        if (format == "rle") ReadRLE(addr, run);
+        else if (format == "life106") ReadLife106(addr, run);
+        else ReadPlaintext(addr, run);
+    }
+
+    // The live cells of a pattern and the size of its grid
+    struct Cells {
+        std::vector<std::pair<long int, long int>> cells;   // (x, y)
+        long int w = 0, h = 0;
+    };
+
+    // Reads a pattern of ./src/ in any known format. The grid of a
+    // plaintext pattern keeps its dead rows and columns. Nothing is
+    // shared, so it may run on any thread.
+    Cells read_cells(string addr) {
+        Cells pattern;
+        auto add = [&](long int x, long int y, long int n) {
+            for (long int i = 0; i < n; i++) pattern.cells.push_back({x + i, y});
+            pattern.w = std::max(pattern.w, x + n);
+            pattern.h = std::max(pattern.h, y + 1);
+        };
+        if (PatternFormat("./src/" + addr) != "plaintext") {
+            ReadCells("./src/" + addr, add);
+            return pattern;
         }
-        // Search currently directory for file
-        return read_from_dir(addr, angle, flip);
+        Vector2D<long int> size = ReadPlaintext("./src/" + addr, add);
+        pattern.w = size.x, pattern.h = size.y;
+        return pattern;
     }
 
+    // A pattern block of a .configuration file
+    struct Placement {
+        string pattern;
+        int angle, flip;
+        Vector2D<> place, anchor;
+    };
+
+    // The grid size and the pattern blocks of a .configuration file
+    struct ConfigFile {
+        int w = 0, h = 0;
+        string rule = "B3/S23";
+        deque<Placement> placements;
+    };
+
     // Reads a .configuration file
-    grid2D Load_Config_File(string addr) {
-        grid2D grid;
+    ConfigFile Load_Config_File(string addr) {
+        ConfigFile config;
         int w = 0, h = 0;
-        string pattern = "";
+        string pattern = "", rule = config.rule;
         int angle = 0, flip = -1;
         Vector2D place = {-1, -1};
         Vector2D anchor = {-1, -1};
@@ -233,29 +458,15 @@ namespace ReadPattern {
             // Check if line is a comment
             if (line[0] == '#' || line == "")
                 continue;
-            // Check if to load and append pattern to grid
+            // Check if to record the grid or the pattern block
             if (line.substr(0, 5) == "[end]") {
                 if (pattern == "grid") {
-                    // Fill in grid with zeroes
-                    grid = NewGrid2D(h, w);
+                    config.w = w, config.h = h;
+                    config.rule = rule;
                 }
                 else {
-                    // Place pattern at position
-                    grid2D array = parser_load(pattern, angle, flip);
-                    // Get the size of the array
-                    int sy = array.size(), sx = array[0].size();
-                    // Configure start and end positions for the pattern on the grid
-                    Vector2D pos = {place.x - sx * anchor.x, place.y - sy * anchor.y};
-                    // Place the pattern on the grid
-                    for (int my = 0; my < sy; my++)
-                    {
-                        for (int mx = 0; mx < sx; mx++)
-                        {
-                            // Can sometimes erase other patterns if all is copied.!!
-                            if (array[my][mx] == ONE)
-                                grid[pos.y + my][pos.x + mx] = array[my][mx];
-                        }
-                    }
+                    // The pattern is placed when the node is built
+                    config.placements.push_back({pattern, angle, flip, place, anchor});
                 }
                 pattern = "";
                 angle = 0, flip = -1;
@@ -272,6 +483,11 @@ namespace ReadPattern {
                 string x = line.substr(2); // Remove "H:" from the line
                 h = stoi(str_trim(x));     // Remove spaces and convert to int
             }
+            else if (line.substr(0, 5) == "rule:")
+            {
+                string x = line.substr(5); // Remove "rule:" from the line
+                rule = str_trim(x);        // B3/S23 style, checked when it is set
+            }
             else if (line[0] == '[' && line[line.length() - 1] == ']')
             {
                 // Make sure it is starting a new block
@@ -320,209 +536,550 @@ namespace ReadPattern {
                 anchor.x = stoi(_anchor[1]), anchor.y = stoi(_anchor[0]);
             }
         }
-        return grid;
+        return config;
     }
 }
 
 namespace GameOfLife {
+    typedef uint32_t node_t;                // Index of a node in the NodeList
+    const node_t DEAD = 0, ALIVE = 1;       // Cells are the nodes of depth 0
+    const node_t NIL = 0xFFFFFFFF;          // Marks a missing node
+
+    // 40 bytes, ordered so that the fields pack without padding
     struct _QTreeNode_ {
-        int depth, area;
-        string nw, ne, sw, se;
+        long int area;
+        uint64_t bits = 0;      // Packed cells of nodes of depth 3 or less
+        node_t nw, ne, sw, se;
+        node_t result = NIL;    // Memoized centered successor
+        int depth;
     };
+    static_assert(sizeof(_QTreeNode_) == 40, "The node should pack into 40 bytes");
 
-    struct _QLeaflet_ {
-        string n;
-        Vector2D<> r1, r2;
-        _QLeaflet_(string _n, Vector2D<> _r1, Vector2D<> _r2):
-            n(_n), r1(_r1), r2(_r2) {}
+    // Checks if two nodes are equal by comparing their quadrants.
+    // The quadrants are canonical, so comparing their handles suffices.
+    const bool _Eq_Node_(const _QTreeNode_ &lhs, const _QTreeNode_ &rhs) {
+        if ((lhs.area != rhs.area) || (lhs.depth != rhs.depth))
+            return false;
+        return (
+            lhs.nw == rhs.nw && lhs.ne == rhs.ne &&
+            lhs.sw == rhs.sw && lhs.se == rhs.se);
+    }
 
-        _QLeaflet_ operator=(const _QLeaflet_ &rhs) {
-            _QLeaflet_ r(rhs.n, rhs.r1, rhs.r2);
-            return r;
+    // Hashes a node by the identity of its quadrants.
+    // The depth, area and result follow from the quadrants so they are left out.
+    struct _QTreeHash_ {
+        size_t operator()(const _QTreeNode_ &n) const {
+            uint64_t h = (uint64_t(n.nw) << 32) | n.ne;
+            h = h * 0x9E3779B97F4A7C15ULL + ((uint64_t(n.sw) << 32) | n.se);
+            h = h * 0xBF58476D1CE4E5B9ULL;
+            return h ^ (h >> 31);
         }
     };
 
-    struct _QConfigure_ {
-        Vector2D<> size;
-        map<int, map<int, string>> array;
+    size_t MemoryCap = 0;               // Hard limit on the bytes of the nodes, 0 for none
+    std::atomic<size_t> TableBytes{0};  // Bytes of the hash-consing table
+
+    // Stores the nodes in fixed chunks that never move once allocated.
+    // Other threads can read the nodes of a published root while new
+    // nodes are being added, which a std::vector would reallocate.
+    // Slots are reserved atomically so that a parallel step can add nodes
+    // from several threads; only a new chunk takes the lock.
+    class _QNodeStore_ {
+        static const int CHUNK_BITS = 16;
+        static const size_t CHUNK = size_t(1) << CHUNK_BITS;
+        std::unique_ptr<_QTreeNode_[]> chunks[size_t(1) << (32 - CHUNK_BITS)];
+        std::atomic<size_t> count{0}, allocated{0};
+        std::mutex grow;
+
+    public:
+        _QNodeStore_() {
+            push_back({0, 0, DEAD, DEAD, DEAD, DEAD, NIL, 0});
+            push_back({1, 1, DEAD, DEAD, DEAD, DEAD, NIL, 0});
+        }
+
+        _QTreeNode_ &operator[](node_t n) {
+            return chunks[n >> CHUNK_BITS][n & (CHUNK - 1)];
+        }
+
+        size_t size() const { return count; }
+        static size_t chunk_bytes() { return CHUNK * sizeof(_QTreeNode_); }
+        size_t capacity() const { return allocated * CHUNK; }
+        _QTreeNode_ &back() { return (*this)[count - 1]; }
+        void pop_back() { count--; }
+
+        // Reserves the next slot, allocating its chunk if needed. A slot is
+        // only claimed once its chunk exists, so a thread stopped by the
+        // memory cap has taken nothing the others could also be given.
+        node_t allocate() {
+            size_t slot = count;
+            while (true) {
+                if (slot < capacity()) {
+                    if (count.compare_exchange_weak(slot, slot + 1)) return slot;
+                    continue;
+                }
+                std::lock_guard<std::mutex> guard(grow);
+                if (count >= capacity()) {
+                    if (MemoryCap && (capacity() + CHUNK) * sizeof(_QTreeNode_) + TableBytes > MemoryCap)
+                        throw std::length_error("Memory cap reached");
+                    chunks[allocated].reset(new _QTreeNode_[CHUNK]), allocated++;
+                }
+                slot = count;
+            }
+        }
 
-        _QConfigure_() {}
-        _QConfigure_(int s) {
-            size.x = s, size.y = s;
+        void push_back(const _QTreeNode_ &node) {
+            (*this)[allocate()] = node;
         }
-        _QConfigure_(Vector2D<> s) {
-            size.x = s.x, size.y = s.y;
+
+        // Releases the chunks past the last node
+        void shrink_to_fit() {
+            while (allocated > 1 && (allocated - 1) * CHUNK >= count)
+                chunks[--allocated].reset();
         }
+    };
 
-        bool find(int a, int b) {
-            // First check if "a" is in the map
-            if (array.find(a) == array.end()) return false;
-            if (array[a].find(b) == array[a].end()) return false;
-            return true;
+    // An outer-totalistic rule: bit k of birth (survival) is set when a
+    // dead (live) cell with k live neighbours is alive in the next generation
+    struct _QRule_ {
+        uint16_t birth = 1 << 3;
+        uint16_t survival = 1 << 2 | 1 << 3;
+        bool operator==(const _QRule_ &rhs) const {
+            return birth == rhs.birth && survival == rhs.survival;
         }
     };
 
-    long int address = 99;              // Unique address for the Nodes
-    long int GENERATION = 0;            // Keep track of the number of generations
-    string Configuration = "";          // The current configuration
-    map<string, _QTreeNode_> NodeList;  // A list of all referenced nodes
+    const _QRule_ CONWAY;               // B3/S23
+    _QRule_ RULE;                       // The rule being simulated
+    uint64_t GENERATION = 0;            // Keep track of the number of generations
+    int STEP = 0;                       // Each step advances 2^STEP generations
+    const int MAX_STEP = 60;            // Keeps GENERATION from overflowing
+    std::atomic<long int> CacheHits{0};     // NextGeneration calls answered by the memo
+    std::atomic<long int> CacheMisses{0};   // NextGeneration calls that were computed
+    // Calls counted by this thread and not yet added to the totals
+    thread_local long int LocalHits = 0, LocalMisses = 0;
+    node_t Configuration = DEAD;        // The current configuration
+    // A list of all referenced nodes, starting with the DEAD and ALIVE cells.
+    // Handles index this list and the nodes never move.
+    _QNodeStore_ NodeList;
+    // Hash-consing table: quadrants -> handle of the canonical node.
+    // It is split into stripes, each behind its own lock, so that the
+    // threads of a parallel step rarely wait on one another. A stripe is
+    // open addressed with linear probing over bare handles, as the nodes
+    // themselves are in the NodeList, so an entry costs 4 bytes.
+    const int STRIPE_BITS = 6;
+    struct _QIndexStripe_ {
+        std::mutex lock;
+        std::vector<node_t> slots;      // A power of two, NIL when empty
+        size_t count = 0;
+    };
+    _QIndexStripe_ NodeIndex[1 << STRIPE_BITS];
+    // Slots of the NodeList freed by the garbage collector, marked depth -1
+    std::vector<node_t> FreeList;
+    std::atomic<size_t> FreeCount{0};   // Slots left in the FreeList
+    std::mutex FreeLock;                // Guards the FreeList during a step
+    int Threads = 1;                    // Threads of a step, one needs no locks
+    // Roots held outside of the Configuration, kept alive by the collector
+    deque<node_t> Snapshots;
+
+    // A pattern of ./src/ and its nodes in the 8 orientations: turned
+    // clockwise 0 to 3 times, then mirrored left to right for 4 to 7
+    struct _QPattern_ {
+        ReadPattern::Cells cells;
+        std::array<node_t, 8> nodes;    // NIL until first used
+
+        _QPattern_() { nodes.fill(NIL); }
+    };
 
-    // Checks if two nodes are equal by comparing their quadrants.
-    // It recursively checks if the quadrants are equivalent...
-    // until it gets to its base values ALIVE(1), DEAD(0)
-    const bool _Eq_Node_(_QTreeNode_ &lhs, _QTreeNode_ &rhs) {
-        if ((lhs.area != rhs.area) || (lhs.depth != rhs.depth))
-            return false;
-        return (
-            lhs.nw == rhs.nw && lhs.ne == rhs.ne &&
-            lhs.sw == rhs.sw && lhs.se == rhs.se);
+    // The patterns read so far, by file name. Their nodes are roots.
+    map<string, _QPattern_> Library;
+    std::mutex LibraryLock;             // Guards the Library against the Indexer
+    size_t MemoryBudget = size_t(1) << 30;  // Collect garbage above this many bytes
+    size_t Collected = 0;               // Bytes left by the last collection
+    bool VerboseGC = false;             // Print a line per collection
+    size_t Collections = 0, Freed = 0;  // Collections and nodes freed so far
+    double CollectingMs = 0.;           // Time spent collecting so far
+
+    // The top bits of the hash pick the stripe and the others the slot
+    _QIndexStripe_ &StripeOf(size_t hash) {
+        return NodeIndex[hash >> (64 - STRIPE_BITS)];
     }
 
-    // Checks if two nodes are equal using their address.
-    // It points to the TreeNode overload function.
-    const bool _Eq_Node_(const string &lhs, const string &rhs) {
-        return _Eq_Node_(NodeList.at(lhs), NodeList.at(rhs));
+    // Finds the slot of the node in its stripe, or the empty slot where it
+    // would go. The stripe must not be empty.
+    size_t Probe(const _QIndexStripe_ &stripe, const _QTreeNode_ &node, size_t hash) {
+        size_t mask = stripe.slots.size() - 1;
+        for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+            node_t addr = stripe.slots[slot];
+            if (addr == NIL || _Eq_Node_(NodeList[addr], node)) return slot;
+        }
     }
 
-    // Finds the address for any node
-    const string FindNode(_QTreeNode_ &node) {
-        // Make sure that the node is legitimate.
-        assert(node.nw != "");
-        assert(node.ne != "");
-        assert(node.sw != "");
-        assert(node.se != "");
-        assert(node.depth != 0);
-        // Find the key to the node
-        for (auto &[k, n] : NodeList) {
-            if (_Eq_Node_(n, node))
-                return k;
+    // Resizes a stripe to the given number of slots and puts its handles back
+    void Resize(_QIndexStripe_ &stripe, size_t size) {
+        size_t added = (size - stripe.slots.size()) * sizeof(node_t);
+        if (MemoryCap && size > stripe.slots.size() &&
+            NodeList.capacity() * sizeof(_QTreeNode_) + TableBytes + added > MemoryCap)
+            throw std::length_error("Memory cap reached");
+        std::vector<node_t> handles(size, NIL);
+        handles.swap(stripe.slots);
+        TableBytes += added;
+        for (node_t addr : handles) {
+            if (addr == NIL) continue;
+            const _QTreeNode_ &n = NodeList[addr];
+            stripe.slots[Probe(stripe, n, _QTreeHash_()(n))] = addr;
         }
-        return "";
+    }
+
+    // Takes a slot freed by the collector, or a new one
+    const node_t NewSlot() {
+        if (FreeCount > 0) {
+            std::lock_guard<std::mutex> guard(FreeLock);
+            if (!FreeList.empty()) {
+                node_t addr = FreeList.back();
+                FreeList.pop_back();
+                FreeCount--;
+                return addr;
+            }
+        }
+        return NodeList.allocate();
     }
 
     // Adds and initialises the new node.
-    // Returns the address of the new node;
-    const string AddNode(_QTreeNode_ &node) {
-        string addr = FindNode(node);
+    // Returns the handle of the new node;
+    const node_t AddNode(const _QTreeNode_ &node) {
+        size_t hash = _QTreeHash_()(node);
+        _QIndexStripe_ &stripe = StripeOf(hash);
+        std::unique_lock<std::mutex> guard(stripe.lock, std::defer_lock);
+        if (Threads > 1) guard.lock();
+        // Keep the stripe at most three quarters full
+        if ((stripe.count + 1) * 4 > stripe.slots.size() * 3)
+            Resize(stripe, std::max<size_t>(64, stripe.slots.size() * 2));
+        size_t slot = Probe(stripe, node, hash);
+        if (stripe.slots[slot] != NIL)
+            return stripe.slots[slot];
         // Create a new node if it does not exist
-        if (addr == "") {
-            address++;
-            addr = to_string(address);
-            NodeList[addr] = node;
-        }
+        PROFILE_COUNT("AddNode");
+        node_t addr = NewSlot();
+        NodeList[addr] = node;
+        stripe.slots[slot] = addr;
+        stripe.count++;
         return addr;
     }
 
-    // Uses bit int values to generate a canonical node
-    const string NewNode(int nw, int ne, int sw, int se) {
-        _QTreeNode_ newnode;
-        newnode.area = nw + ne + sw + se;
-        newnode.nw = to_string(nw);
-        newnode.ne = to_string(ne);
-        newnode.sw = to_string(sw);
-        newnode.se = to_string(se);
-        newnode.depth = 1;
-        return AddNode(newnode);
+    // Packs the cells of four quadrants of 2^half cells a side into the
+    // cells of their parent, row by row from the top left: bit y * side + x
+    const uint64_t PackBits(int half, uint64_t nw, uint64_t ne, uint64_t sw, uint64_t se) {
+        const uint64_t mask = (uint64_t(1) << half) - 1;
+        const int side = half * 2;
+        uint64_t bits = 0;
+        for (int y = 0; y < half; y++) {
+            bits |= ((nw >> (y * half)) & mask) << (y * side);
+            bits |= ((ne >> (y * half)) & mask) << (y * side + half);
+            bits |= ((sw >> (y * half)) & mask) << ((y + half) * side);
+            bits |= ((se >> (y * half)) & mask) << ((y + half) * side + half);
+        }
+        return bits;
     }
 
-    // Uses node references to generate a new node, or...
-    // uses bit char to generate a canonical node
-    const string NewNode(string &nw, string &ne, string &sw, string &se) {
-        // Check and handle when they are ALIVE(1) or DEAD(0) cells
-        if ((nw == "1" || nw == "0") && (ne == "1" || ne == "0")) {
-            if ((sw == "1" || sw == "0") && (se == "1" || se == "0")) {
-                return NewNode((nw == "1") ? 1 : 0, (ne == "1") ? 1 : 0, (sw == "1") ? 1 : 0, (se == "1") ? 1 : 0);
-            }
-        }
+    // Uses node handles to generate a new node.
+    // DEAD(0) and ALIVE(1) quadrants generate a canonical node
+    const node_t NewNode(node_t nw, node_t ne, node_t sw, node_t se) {
+        PROFILE_COUNT("NewNode");
+        const _QTreeNode_ &NW = NodeList[nw], &NE = NodeList[ne];
+        const _QTreeNode_ &SW = NodeList[sw], &SE = NodeList[se];
         // Make sure that they are all of the same depth
-        if (NodeList.at(nw).depth != NodeList.at(ne).depth)
+        if (NW.depth != NE.depth)
             throw std::invalid_argument("Must be the same depth");
-        if (NodeList.at(ne).depth != NodeList.at(sw).depth)
+        if (NE.depth != SW.depth)
             throw std::invalid_argument("Must be the same depth");
-        if (NodeList.at(sw).depth != NodeList.at(se).depth)
+        if (SW.depth != SE.depth)
             throw std::invalid_argument("Must be the same depth");
-        if (NodeList.at(nw).depth == 0)
-            throw std::invalid_argument("Depth must be greater than one");
 
         _QTreeNode_ newnode;
         newnode.nw = nw;
         newnode.ne = ne;
         newnode.sw = sw;
         newnode.se = se;
-        newnode.depth = NodeList.at(nw).depth + 1;
-        newnode.area = NodeList.at(nw).area + NodeList.at(ne).area;
-        newnode.area += NodeList.at(sw).area + NodeList.at(se).area;
+        newnode.depth = NW.depth + 1;
+        newnode.area = NW.area + NE.area + SW.area + SE.area;
+        // Leaves up to 8x8 cells carry their cells for the leaf kernel
+        if (newnode.depth <= 3)
+            newnode.bits = PackBits(1 << NW.depth, NW.bits, NE.bits, SW.bits, SE.bits);
         return AddNode(newnode);
     }
 
     // Returns the center cell when aligned horizontally
-    const string CenteredHorizontal(string &west, string &east) {
-        _QTreeNode_ &W = NodeList.at(west), &E = NodeList.at(east);
+    const node_t CenteredHorizontal(node_t west, node_t east) {
+        const _QTreeNode_ &W = NodeList[west], &E = NodeList[east];
         return NewNode(
-            NodeList.at(W.ne).se, NodeList.at(E.nw).sw,
-            NodeList.at(W.se).ne, NodeList.at(E.sw).nw);
+            NodeList[W.ne].se, NodeList[E.nw].sw,
+            NodeList[W.se].ne, NodeList[E.sw].nw);
     }
 
     // Returns the center cell when aligned vertically
-    const string CenteredVertical(string &north, string &south) {
-        _QTreeNode_ &N = NodeList.at(north), &S = NodeList.at(south);
+    const node_t CenteredVertical(node_t north, node_t south) {
+        const _QTreeNode_ &N = NodeList[north], &S = NodeList[south];
         return NewNode(
-            NodeList.at(N.sw).se, NodeList.at(N.se).sw,
-            NodeList.at(S.nw).ne, NodeList.at(S.ne).nw);
+            NodeList[N.sw].se, NodeList[N.se].sw,
+            NodeList[S.nw].ne, NodeList[S.ne].nw);
     }
 
     // Returns the center cell when centered
-    const string CenteredSubNode(string &node) {
-        _QTreeNode_ &n = NodeList.at(node);
+    const node_t CenteredSubNode(node_t node) {
+        const _QTreeNode_ &n = NodeList[node];
         return NewNode(
-            NodeList.at(n.nw).se, NodeList.at(n.ne).sw,
-            NodeList.at(n.sw).ne, NodeList.at(n.se).nw);
+            NodeList[n.nw].se, NodeList[n.ne].sw,
+            NodeList[n.sw].ne, NodeList[n.se].nw);
+    }
+
+    // Returns the node straddling two nodes aligned horizontally
+    const node_t JoinHorizontal(node_t west, node_t east) {
+        const _QTreeNode_ &W = NodeList[west], &E = NodeList[east];
+        return NewNode(W.ne, E.nw, W.se, E.sw);
+    }
+
+    // Returns the node straddling two nodes aligned vertically
+    const node_t JoinVertical(node_t north, node_t south) {
+        const _QTreeNode_ &N = NodeList[north], &S = NodeList[south];
+        return NewNode(N.sw, N.se, S.nw, S.ne);
     }
 
     // Returns the center cell when centered x2
-    const string CenteredSubSubNode(string &node) {
-        _QTreeNode_ &n = NodeList.at(node);
+    const node_t CenteredSubSubNode(node_t node) {
+        const _QTreeNode_ &n = NodeList[node];
         return NewNode(
-            NodeList.at(NodeList.at(n.nw).se).se, NodeList.at(NodeList.at(n.ne).sw).sw,
-            NodeList.at(NodeList.at(n.sw).ne).ne, NodeList.at(NodeList.at(n.se).nw).nw);
-    }
-
-    // Applies Conway's Game of Life rules
-    const string TheRules(string &node) {
-        auto Rule = [](const char cell, const int alive) {
-            if (cell == 0 && alive == 3)
-                return 1; // Dead cell revives: Reproduction
-            if (cell == 1 && (alive == 2 || alive == 3))
-                return 1; // Alive cell survives
-            return 0;     // Over-/Under-population
+            NodeList[NodeList[n.nw].se].se, NodeList[NodeList[n.ne].sw].sw,
+            NodeList[NodeList[n.sw].ne].ne, NodeList[NodeList[n.se].nw].nw);
+    }
+
+    // Creates the 16 depth-1 nodes, indexed by their packed cells
+    std::array<node_t, 16> CanonicalNodes() {
+        std::array<node_t, 16> nodes;
+        for (int bits = 0; bits < 16; bits++)
+            nodes[bits] = NewNode(bits & 1, bits >> 1 & 1, bits >> 2 & 1, bits >> 3 & 1);
+        return nodes;
+    }
+
+    // Made at startup so that the threads of a step only ever read it
+    const std::array<node_t, 16> Canonical = CanonicalNodes();
+
+    // Returns the depth-1 node of the 4 packed cells
+    const node_t CanonicalNode(uint64_t bits) {
+        return Canonical[bits & 15];
+    }
+
+    // Rebuilds the node of depth 3 or less from its packed cells
+    const node_t NodeFromBits(uint64_t bits, int depth) {
+        if (depth == 0) return (bits & 1) ? ALIVE : DEAD;
+        if (depth == 1) return CanonicalNode(bits);
+        const int half = 1 << (depth - 1), side = half * 2;
+        const uint64_t mask = (uint64_t(1) << half) - 1;
+        uint64_t nw = 0, ne = 0, sw = 0, se = 0;
+        for (int y = 0; y < half; y++) {
+            nw |= ((bits >> (y * side)) & mask) << (y * half);
+            ne |= ((bits >> (y * side + half)) & mask) << (y * half);
+            sw |= ((bits >> ((y + half) * side)) & mask) << (y * half);
+            se |= ((bits >> ((y + half) * side + half)) & mask) << (y * half);
+        }
+        return NewNode(
+            NodeFromBits(nw, depth - 1), NodeFromBits(ne, depth - 1),
+            NodeFromBits(sw, depth - 1), NodeFromBits(se, depth - 1));
+    }
+
+    // Adds up eight one-bit neighbour planes with full adders, giving the
+    // count of every cell at once in bit-sliced form: c[0] ones to c[3] eights
+    template <typename lane_t>
+    void CountNeighbours(const lane_t x[8], lane_t c[4]) {
+        auto add = [](const lane_t &a, const lane_t &b, const lane_t &d, lane_t &sum, lane_t &carry) {
+            lane_t t = a ^ b;
+            sum = t ^ d, carry = (a & b) | (t & d);
+        };
+        lane_t s1, c1, s2, c2, k1, t1, d1;
+        add(x[0], x[1], x[2], s1, c1);
+        add(x[3], x[4], x[5], s2, c2);
+        lane_t s3 = x[6] ^ x[7], c3 = x[6] & x[7];
+        add(s1, s2, s3, c[0], k1);
+        add(c1, c2, c3, t1, d1);
+        lane_t d2 = t1 & k1;
+        c[1] = t1 ^ k1;
+        c[2] = d1 ^ d2, c[3] = d1 & d2;
+    }
+
+    // Applies the RULE to a plane of cells and their neighbours
+    template <typename lane_t>
+    lane_t LifeRule(const lane_t &alive, const lane_t x[8]) {
+        lane_t c[4];
+        CountNeighbours(x, c);
+        // Two neighbours keep a cell alive, three make it alive
+        if (RULE == CONWAY)
+            return c[1] & ~c[2] & ~c[3] & (c[0] | alive);
+        // Otherwise match the count against each number of the rule
+        lane_t born = alive ^ alive, kept = born;
+        for (int k = 0; k <= 8; k++) {
+            if (((RULE.birth | RULE.survival) >> k & 1) == 0) continue;
+            lane_t count = ((k & 1) ? c[0] : ~c[0]) & ((k & 2) ? c[1] : ~c[1]) &
+                           ((k & 4) ? c[2] : ~c[2]) & ((k & 8) ? c[3] : ~c[3]);
+            if (RULE.birth >> k & 1) born = born | count;
+            if (RULE.survival >> k & 1) kept = kept | count;
+        }
+        return (born & ~alive) | (kept & alive);
+    }
+
+#ifdef __SSE2__
+    // Eight rows of 16 cells in one SSE2 register
+    struct _QLanes_ {
+        __m128i v;
+        _QLanes_ operator&(const _QLanes_ &rhs) const { return {_mm_and_si128(v, rhs.v)}; }
+        _QLanes_ operator|(const _QLanes_ &rhs) const { return {_mm_or_si128(v, rhs.v)}; }
+        _QLanes_ operator^(const _QLanes_ &rhs) const { return {_mm_xor_si128(v, rhs.v)}; }
+        _QLanes_ operator~() const { return {_mm_xor_si128(v, _mm_set1_epi32(-1))}; }
+    };
+
+    // Advances 16 rows of 16 cells, bit x of a row being column x.
+    // The top and bottom halves each fill a register, and the rows above
+    // and below are the registers shifted by one row across the halves.
+    void StepTile(uint16_t rows[16], int generations) {
+        __m128i top = _mm_loadu_si128((const __m128i *)rows);
+        __m128i bottom = _mm_loadu_si128((const __m128i *)(rows + 8));
+        auto plane = [](const __m128i &up, const __m128i &row, const __m128i &down) {
+            _QLanes_ x[8] = {
+                {_mm_slli_epi16(up, 1)}, {up}, {_mm_srli_epi16(up, 1)},
+                {_mm_slli_epi16(row, 1)}, {_mm_srli_epi16(row, 1)},
+                {_mm_slli_epi16(down, 1)}, {down}, {_mm_srli_epi16(down, 1)}};
+            return LifeRule(_QLanes_{row}, x).v;
         };
+        for (int g = 0; g < generations; g++) {
+            __m128i up = _mm_slli_si128(top, 2);
+            __m128i down = _mm_or_si128(_mm_srli_si128(top, 2), _mm_slli_si128(bottom, 14));
+            __m128i next = plane(up, top, down);
+            up = _mm_or_si128(_mm_slli_si128(bottom, 2), _mm_srli_si128(top, 14));
+            down = _mm_srli_si128(bottom, 2);
+            bottom = plane(up, bottom, down);
+            top = next;
+        }
+        _mm_storeu_si128((__m128i *)rows, top);
+        _mm_storeu_si128((__m128i *)(rows + 8), bottom);
+    }
+#else
+    // Advances 16 rows of 16 cells, bit x of a row being column x
+    void StepTile(uint16_t rows[16], int generations) {
+        for (int g = 0; g < generations; g++) {
+            uint16_t next[16];
+            for (int y = 0; y < 16; y++) {
+                uint32_t up = (y > 0) ? rows[y - 1] : 0, row = rows[y];
+                uint32_t down = (y < 15) ? rows[y + 1] : 0;
+                uint32_t x[8] = {
+                    up << 1, up, up >> 1, row << 1, row >> 1,
+                    down << 1, down, down >> 1};
+                next[y] = LifeRule(row, x) & 0xFFFF;
+            }
+            std::copy(next, next + 16, rows);
+        }
+    }
+#endif
+
+    // Computes the packed 2x2 center successor of every 4x4 block,
+    // indexed by the 16 packed cells of the block
+    std::array<uint8_t, 65536> BuildRuleTable() {
+        std::array<uint8_t, 65536> table;
+        for (uint32_t block = 0; block < 65536; block++) {
+            uint32_t rows[4], center[2];
+            for (int y = 0; y < 4; y++) rows[y] = block >> (y * 4) & 15;
+            for (int y = 1; y < 3; y++) {
+                uint32_t up = rows[y - 1], row = rows[y], down = rows[y + 1];
+                uint32_t x[8] = {
+                    up << 1, up, up >> 1, row << 1, row >> 1,
+                    down << 1, down, down >> 1};
+                center[y - 1] = LifeRule(row, x) >> 1 & 3;
+            }
+            table[block] = center[0] | center[1] << 2;
+        }
+        return table;
+    }
+
+    std::array<uint8_t, 65536> RuleTable = BuildRuleTable();
 
-        _QTreeNode_ &n = NodeList.at(node);
+    // Applies the RULE to a depth-2 node.
+    // Its packed cells index the successor in the RuleTable.
+    const node_t TheRules(node_t node) {
+        const _QTreeNode_ &n = NodeList[node];
         if (n.depth != 2)
             throw std::invalid_argument("Unexpected depth");
-        deque<deque<int>> M = {
-            {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0}};
-        M[1][1] = stoi(NodeList.at(n.nw).nw), M[1][2] = stoi(NodeList.at(n.nw).ne),
-        M[1][3] = stoi(NodeList.at(n.ne).nw), M[1][4] = stoi(NodeList.at(n.ne).ne),
-        M[2][1] = stoi(NodeList.at(n.nw).sw), M[2][2] = stoi(NodeList.at(n.nw).se),
-        M[2][3] = stoi(NodeList.at(n.ne).sw), M[2][4] = stoi(NodeList.at(n.ne).se),
-        M[3][1] = stoi(NodeList.at(n.sw).nw), M[3][2] = stoi(NodeList.at(n.sw).ne),
-        M[3][3] = stoi(NodeList.at(n.se).nw), M[3][4] = stoi(NodeList.at(n.se).ne),
-        M[4][1] = stoi(NodeList.at(n.sw).sw), M[4][2] = stoi(NodeList.at(n.sw).se),
-        M[4][3] = stoi(NodeList.at(n.se).sw), M[4][4] = stoi(NodeList.at(n.se).se);
-        return NewNode(
-            Rule(M[2][2], M[1][1] + M[1][2] + M[1][3] + M[2][1] + M[2][3] + M[3][1] + M[3][2] + M[3][3]),
-            Rule(M[2][3], M[1][2] + M[1][3] + M[1][4] + M[2][2] + M[2][4] + M[3][2] + M[3][3] + M[3][4]),
-            Rule(M[3][2], M[2][1] + M[2][2] + M[2][3] + M[3][1] + M[3][3] + M[4][1] + M[4][2] + M[4][3]),
-            Rule(M[3][3], M[2][2] + M[2][3] + M[2][4] + M[3][2] + M[3][4] + M[4][2] + M[4][3] + M[4][4]));
+        return CanonicalNode(RuleTable[n.bits]);
+    }
+
+    // Parses a rule as B3/S23, or in the older S/B form as 23/3
+    const _QRule_ ParseRule(string text) {
+        _QRule_ rule;
+        auto digits = [&](string part) {
+            uint16_t bits = 0;
+            for (const char &c : part) {
+                if (c < '0' || c > '8')
+                    throw std::invalid_argument("Bad rule " + text);
+                bits |= 1 << (c - '0');
+            }
+            return bits;
+        };
+        auto parts = str_split(text, "/");
+        if (parts.size() != 2)
+            throw std::invalid_argument("Bad rule " + text);
+        string first = str_trim(parts[0]), second = str_trim(parts[1]);
+        if (toupper(first[0]) == 'B' && toupper(second[0]) == 'S')
+            rule.birth = digits(first.substr(1)), rule.survival = digits(second.substr(1));
+        else if (toupper(first[0]) == 'S' && toupper(second[0]) == 'B')
+            rule.survival = digits(first.substr(1)), rule.birth = digits(second.substr(1));
+        else
+            rule.survival = digits(first), rule.birth = digits(second);
+        // Empty space would come alive, which the quadtree cannot represent
+        if (rule.birth & 1)
+            throw std::invalid_argument("B0 rules are not supported: " + text);
+        return rule;
+    }
+
+    // Writes a rule as B3/S23
+    const string RuleString(const _QRule_ &rule) {
+        string text = "B";
+        for (int k = 0; k <= 8; k++) if (rule.birth >> k & 1) text += char('0' + k);
+        text += "/S";
+        for (int k = 0; k <= 8; k++) if (rule.survival >> k & 1) text += char('0' + k);
+        return text;
+    }
+
+    // Changes the rule and forgets every memoized result, as they were
+    // all computed under the old one
+    void SetRule(const _QRule_ &rule) {
+        if (rule == RULE) return;
+        RULE = rule;
+        RuleTable = BuildRuleTable();
+        for (node_t node = 0; node < NodeList.size(); node++)
+            NodeList[node].result = NIL;
+    }
+
+    bool LeafKernel = true;             // Stops the recursion at 16x16 leaves
+
+    // Computes the centered successor of a 16x16 node from the packed
+    // cells of its quadrants. Each generation spoils one more ring of the
+    // border, so the center 8x8 holds up to 4 generations, 2^min(STEP, 2).
+    const node_t LeafSuccessor(node_t node) {
+        const _QTreeNode_ &n = NodeList[node];
+        const uint64_t nw = NodeList[n.nw].bits, ne = NodeList[n.ne].bits;
+        const uint64_t sw = NodeList[n.sw].bits, se = NodeList[n.se].bits;
+        uint16_t rows[16];
+        for (int y = 0; y < 8; y++) {
+            rows[y] = ((nw >> (y * 8)) & 0xFF) | ((ne >> (y * 8)) & 0xFF) << 8;
+            rows[y + 8] = ((sw >> (y * 8)) & 0xFF) | ((se >> (y * 8)) & 0xFF) << 8;
+        }
+        StepTile(rows, 1 << std::min(STEP, 2));
+        uint64_t center = 0;
+        for (int y = 0; y < 8; y++)
+            center |= uint64_t((rows[y + 4] >> 4) & 0xFF) << (y * 8);
+        return NodeFromBits(center, 3);
     }
 
     // Returns a stack of C0000 canonical
-    const string stack_C0000(int depth) {
-        if (depth == 0)
-            throw std::invalid_argument("Too deep to handle");
-        string zeros = NewNode(0, 0, 0, 0);
-        for (int x = 2; x < depth + 1; x++)
+    const node_t stack_C0000(int depth) {
+        node_t zeros = DEAD;
+        for (int x = 1; x < depth + 1; x++)
         {
             zeros = NewNode(zeros, zeros, zeros, zeros);
         }
@@ -530,272 +1087,1980 @@ namespace GameOfLife {
     }
 
     // Appropriately pads a node
-    const string PadNode(string &node) {
-        _QTreeNode_ &n = NodeList.at(node);
-        string border = stack_C0000(n.depth - 1);
-        string reNW = NewNode(border, border, border, n.nw);
-        string reNE = NewNode(border, border, n.ne, border);
-        string reSW = NewNode(border, n.sw, border, border);
-        string reSE = NewNode(n.se, border, border, border);
+    const node_t PadNode(node_t node) {
+        const _QTreeNode_ n = NodeList[node];
+        node_t border = stack_C0000(n.depth - 1);
+        node_t reNW = NewNode(border, border, border, n.nw);
+        node_t reNE = NewNode(border, border, n.ne, border);
+        node_t reSW = NewNode(border, n.sw, border, border);
+        node_t reSE = NewNode(n.se, border, border, border);
         return NewNode(reNW, reNE, reSW, reSE);
     }
 
     // Removes excess zero leafs
-    const string StripNode(string &node) {
+    const node_t StripNode(node_t node) {
         while (true) {
             // Limit split up to the first layer layer
-            if (NodeList.at(node).depth == 1) break;
-            string center = CenteredSubNode(node);
-            if (NodeList.at(node).area == NodeList.at(center).area)
+            if (NodeList[node].depth == 1) break;
+            node_t center = CenteredSubNode(node);
+            if (NodeList[node].area == NodeList[center].area)
                 node = center;
             else break;
         }
         return node;
     }
 
-    // Reads the node as a 2x2 matrix
-    _QConfigure_ ReadConfigurationAsMap() {
-        _QConfigure_ config(
-            pow(2, NodeList.at(Configuration).depth)
-        );
-        { // Remove all zeroes
-            deque<_QLeaflet_> buffer, rebuff;
-            string zero = NewNode(0, 0, 0, 0);
-            buffer = {{Configuration, {1, 1}, config.size}};
-            auto _Add = [&](string &n, Vector2D<int> &c1, Vector2D<int> &c2, bool buffer) {
-                if (NodeList.at(n).area == 0)
-                    return; // Does nothing if the node is all zero
-                // Check if the depth is reasonable
-                if (NodeList.at(n).depth == 0)
-                    throw std::invalid_argument("Depth must be above 0");
-                // Adds everything else to the buffer
-                if (buffer)
-                    return rebuff.push_back({n, c1, c2});
-                // Checks if the block is not deep enough
-                if (NodeList.at(n).depth != 1)
-                    throw std::invalid_argument("Uncanonical of depth" + to_string(NodeList.at(n).depth));
-                // Maps the entirety of the canonical node
-                Vector2D r = c1;
-                auto m = NodeList.at(n);
-                r.x = r.x - 1, r.y = r.y - 1;
-                config.array[r.y][r.x] = m.nw;
-                config.array[r.y][r.x + 1] = m.ne;
-                config.array[r.y + 1][r.x] = m.sw;
-                config.array[r.y + 1][r.x + 1] = m.se;
-            };
-            // Get the alive parts of the array as canonical
-            while (buffer.size() > 0) {
-                rebuff.clear();
-                for (_QLeaflet_ &b : buffer) {
-                    auto n = NodeList.at(b.n);
-                    // Divide the section into nw, ne, sw, se by index
-                    Vector2D<int> r3 = {
-                        (b.r2.x + b.r1.x - 1) / 2,
-                        (b.r2.y + b.r1.y - 1) / 2};
-                    Vector2D<int> nw1 = b.r1, nw2 = r3;
-                    Vector2D<int> ne1 = {r3.x + 1, b.r1.y}, ne2 = {b.r2.x, r3.y};
-                    Vector2D<int> sw1 = {b.r1.x, r3.y + 1}, sw2 = {r3.x, b.r2.y};
-                    Vector2D<int> se1 = {r3.x + 1, r3.y + 1}, se2 = b.r2;
-                    // Append to list for further recursion
-                    if (NodeList.at(b.n).depth > 2) {
-                        _Add(NodeList.at(b.n).nw, nw1, nw2, true);
-                        _Add(NodeList.at(b.n).ne, ne1, ne2, true);
-                        _Add(NodeList.at(b.n).sw, sw1, sw2, true);
-                        _Add(NodeList.at(b.n).se, se1, se2, true);
-                    }
-                    else if (NodeList.at(b.n).depth == 2) {
-                        _Add(NodeList.at(b.n).nw, nw1, nw2, false);
-                        _Add(NodeList.at(b.n).ne, ne1, ne2, false);
-                        _Add(NodeList.at(b.n).sw, sw1, sw2, false);
-                        _Add(NodeList.at(b.n).se, se1, se2, false);
-                    }
-                    else if (NodeList.at(b.n).depth == 1) {
-                        _Add(b.n, nw1, nw2, false);
-                    }
-                }
-                buffer.clear();
-                buffer = rebuff;
-            }
-        }
+    const node_t NextGeneration(node_t node);
 
-        return config;
+    // Adds the calls counted by this thread to the totals
+    void FlushCounters() {
+        CacheHits += LocalHits, CacheMisses += LocalMisses;
+        LocalHits = 0, LocalMisses = 0;
     }
 
-    // Computes the next generation of the grid
-    const string NextGeneration(string &node) {
-        _QTreeNode_ &n = NodeList.at(node);
+    // Runs the subproblems of the top of the recursion on several threads.
+    // Each thread pushes and pops work at the back of its own deque, and
+    // steals from the front of the others' once its own runs dry. A thread
+    // waiting for its subproblems keeps running tasks in the meantime.
+    class _QTaskPool_ {
+        struct _QQueue_ {
+            std::mutex lock;
+            deque<std::function<void()>> tasks;
+        };
+        std::vector<std::unique_ptr<_QQueue_>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<int> queued{0};
+        std::atomic<bool> stopping{false};
+        std::mutex idle;
+        std::condition_variable wake;
+        static thread_local int self;   // Queue of this thread, 0 for callers
+
+        // Takes a task from the back of a queue, or from the front when stealing
+        bool Take(int q, bool steal, std::function<void()> &task) {
+            _QQueue_ &queue = *queues[q];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty()) return false;
+            if (steal) task = std::move(queue.tasks.front()), queue.tasks.pop_front();
+            else task = std::move(queue.tasks.back()), queue.tasks.pop_back();
+            queued--;
+            return true;
+        }
 
-        if (n.area == 0) return CenteredSubNode(node);
-        if (n.depth == 2) return TheRules(node);
+        // Runs one task if there is any
+        bool RunOne() {
+            std::function<void()> task;
+            bool found = Take(self, false, task);
+            for (int q = 1; !found && q <= int(queues.size()); q++)
+                found = Take((self + q) % queues.size(), true, task);
+            if (found) task();
+            return found;
+        }
 
-        // Generate the auxiliary nodes
-        string node11 = CenteredSubNode(n.nw);
-        string node12 = CenteredHorizontal(n.nw, n.ne);
-        string node13 = CenteredSubNode(n.ne);
-        string node21 = CenteredVertical(n.nw, n.sw);
-        string node22 = CenteredSubSubNode(node);
-        string node23 = CenteredVertical(n.ne, n.se);
-        string node31 = CenteredSubNode(n.sw);
-        string node32 = CenteredHorizontal(n.sw, n.se);
-        string node33 = CenteredSubNode(n.se);
+    public:
+        ~_QTaskPool_() { Stop(); }
+
+        void Start(int threads) {
+            Stop();
+            stopping = false;
+            for (int x = 0; x < threads; x++)
+                queues.emplace_back(new _QQueue_);
+            for (int x = 1; x < threads; x++)
+                workers.emplace_back([this, x]() {
+                    self = x;
+                    while (!stopping) {
+                        if (RunOne()) continue;
+                        std::unique_lock<std::mutex> guard(idle);
+                        wake.wait(guard, [this]() { return queued > 0 || stopping; });
+                    }
+                });
+        }
 
-        string aux11 = NewNode(node11, node12, node21, node22);
-        string aux12 = NewNode(node12, node13, node22, node23);
-        string aux21 = NewNode(node21, node22, node31, node32);
-        string aux22 = NewNode(node22, node23, node32, node33);
+        void Stop() {
+            {
+                std::lock_guard<std::mutex> guard(idle);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (std::thread &worker : workers) worker.join();
+            workers.clear(), queues.clear();
+        }
 
-        aux11 = NextGeneration(aux11);
-        aux12 = NextGeneration(aux12);
-        aux21 = NextGeneration(aux21);
-        aux22 = NextGeneration(aux22);
+        // Calls work(0) to work(count - 1) in parallel and waits for them.
+        // The first exception thrown by any of them is thrown again here.
+        void ForEach(int count, const std::function<void(int)> &work) {
+            std::atomic<int> pending{count - 1};
+            std::exception_ptr error;
+            std::mutex failing;
+            {
+                std::lock_guard<std::mutex> guard(queues[self]->lock);
+                for (int x = count - 1; x > 0; x--)
+                    queues[self]->tasks.push_back([&, x]() {
+                        try { work(x); }
+                        catch (...) {
+                            std::lock_guard<std::mutex> guard(failing);
+                            if (!error) error = std::current_exception();
+                        }
+                        FlushCounters();
+                        pending--;
+                    });
+            }
+            {
+                std::lock_guard<std::mutex> guard(idle);
+                queued += count - 1;
+            }
+            wake.notify_all();
+            try { work(0); }
+            catch (...) {
+                std::lock_guard<std::mutex> guard(failing);
+                if (!error) error = std::current_exception();
+            }
+            while (pending > 0)
+                if (!RunOne()) std::this_thread::yield();
+            if (error) std::rethrow_exception(error);
+        }
+    };
+    thread_local int _QTaskPool_::self = 0;
 
-        _QTreeNode_ &a11 = NodeList.at(aux11);
-        _QTreeNode_ &a12 = NodeList.at(aux12);
-        _QTreeNode_ &a21 = NodeList.at(aux21);
-        _QTreeNode_ &a22 = NodeList.at(aux22);
-        return NewNode(aux11, aux12, aux21, aux22);
-    }
+    _QTaskPool_ Pool;
+    int ParallelDepth = 10;             // Nodes deeper than this split over the Pool
 
-    void NextGeneration() {
-        GENERATION++;       // Increase generations past
-        // First pad because fn returns half the block size
-        Configuration = PadNode(Configuration);
-        // This is only used for outside calls...
-        // Other function is called recursively
-        Configuration = NextGeneration(Configuration);
-        Configuration = StripNode(Configuration);
+    // Starts the threads of the parallel step, 1 steps on the caller alone
+    void SetThreads(int threads) {
+        Threads = std::max(1, threads);
+        if (Threads > 1) Pool.Start(Threads);
+        else Pool.Stop();
     }
 
-    // Loads and places the .config file in a node
-    void Load_Config_To_Node(string addr) {
-        // Load the .config file as a grid
-        auto grid = ReadPattern::Load_Config_File(addr);
-        {
-            cout << "[configuration] is ready" << endl;
-            // Get the resolution(size) of the grid
-            Vector2D res = {grid[0].size(), grid.size()};
-            cout << "Grid: w[" << res.x << "] h[" << res.y << "]" << endl;
-            // Calculate the order of magnitude of the grid
-            int k = std::max(res.x, res.y); // The bigger of the two sides
-            k = ceil(log2(k));              // The minimum order of magnitude i.e. 2^k
-            k = pow(2, k);                  // The true grid [quad tree] size
-            cout << "Quadtree: " << k << endl;
-            // Place the grid on the quad tree block [tru grid]
-            Vector2D shift = {(k - res.x) / 2, (k - res.y) / 2};
-            Vector2D remnant = {k - shift.x - res.x, k - shift.y - res.y};
-            cout << "Padding grid to fit quadtree" << endl;
-            // Expand the width of the grid...
-            // by filling with chunks of zeroes on both sides
-            for (int y = 0; y < res.y; y++) {
-                for (int x = 0; x < shift.x; x++) grid[y].push_front(ZERO);
-                for (int x = 0; x < remnant.x; x++) grid[y].push_back(ZERO);
-            }
-            // Expand the height of the grid...
-            // by filling with deque of zeroes on both sides
-            deque<string> zeroes = NewGrid1D(k);
-            for (int y = 0; y < shift.y; y++) grid.push_front(zeroes);
-            for (int y = 0; y < remnant.y; y++) grid.push_back(zeroes);
-            cout << "Grid: w[" << grid[0].size() << "] h[" << grid.size() << "]" << endl;
-        }
-
-        // Convert the grid to a tree node
-        while (grid.size() > 2 && grid[0].size() > 2) {
-            deque<deque<string>> newgrid;
-            for (int y = 0; y < grid.size(); y = y + 2) {
-                deque<string> newrow;
-                for (int x = 0; x < grid[0].size(); x = x + 2) {
-                    newrow.push_back(NewNode(
-                        grid[y][x], grid[y][x + 1],
-                        grid[y + 1][x], grid[y + 1][x + 1]));
-                }
-                newgrid.push_back(newrow);
-            }   grid = newgrid;
-        }
-        // Create the final node and remove excess blocks
-        Configuration = NewNode(
-            grid[0][0], grid[0][1], grid[1][0], grid[1][1]
-        );
-        // Remove excess borders from the configuration
-        Configuration = StripNode(Configuration);
-        cout << "Depth: " << NodeList.at(Configuration).depth << endl;
-        cout << "Area: " << NodeList.at(Configuration).area << endl;
-        cout << "Configuration: " << Configuration << endl;
+    // Replaces each node by its successor, in parallel for deep nodes
+    void Advance(node_t nodes[], int count, int depth) {
+        if (Threads > 1 && depth > ParallelDepth)
+            Pool.ForEach(count, [nodes](int x) { nodes[x] = NextGeneration(nodes[x]); });
+        else for (int x = 0; x < count; x++)
+            nodes[x] = NextGeneration(nodes[x]);
     }
-}
-
-namespace Text {
-    TTF_Font *Font = NULL;
-    SDL_Rect TextRect = {};
-    SDL_Surface *TextSurface = NULL;
-    SDL_Texture *TextTexture = NULL;
-    SDL_Color TextColor = {255, 255, 255, 255};
 
-    void RenderText(SDL_Renderer *renderer, string msg) {
-        TTF_Init();
-
-        Font = TTF_OpenFont("./fonts/07558_CenturyGothic.ttf", 12);
-        if (!Font) {
-            cout << TTF_GetError() << endl;
-            cout << "TTF font unloaded" << endl;
-            return;
+    // Computes the centered successor from the auxiliary nodes.
+    // A node of depth d advances 2^min(STEP, d - 2) generations: when the
+    // step allows it the auxiliary nodes are advanced as well (double-step),
+    // otherwise they are only centered and the recursion does the stepping.
+    const node_t Successor(node_t node) {
+        const _QTreeNode_ &n = NodeList[node];
+        // Generate the auxiliary nodes, row by row
+        node_t sub[9];
+        if (n.depth - 2 <= STEP) {
+            sub[0] = n.nw;
+            sub[1] = JoinHorizontal(n.nw, n.ne);
+            sub[2] = n.ne;
+            sub[3] = JoinVertical(n.nw, n.sw);
+            sub[4] = CenteredSubNode(node);
+            sub[5] = JoinVertical(n.ne, n.se);
+            sub[6] = n.sw;
+            sub[7] = JoinHorizontal(n.sw, n.se);
+            sub[8] = n.se;
+            Advance(sub, 9, n.depth);
         }
-        TextSurface = TTF_RenderText_Solid(Font, msg.c_str(), TextColor);
-        if (!TextSurface) {
-            cout << TTF_GetError() << endl;
-            cout << "TTF unable to create surface" << endl;
-            return;
+        else {
+            sub[0] = CenteredSubNode(n.nw);
+            sub[1] = CenteredHorizontal(n.nw, n.ne);
+            sub[2] = CenteredSubNode(n.ne);
+            sub[3] = CenteredVertical(n.nw, n.sw);
+            sub[4] = CenteredSubSubNode(node);
+            sub[5] = CenteredVertical(n.ne, n.se);
+            sub[6] = CenteredSubNode(n.sw);
+            sub[7] = CenteredHorizontal(n.sw, n.se);
+            sub[8] = CenteredSubNode(n.se);
         }
-        TextTexture = SDL_CreateTextureFromSurface(renderer, TextSurface);
-        if (!TextTexture) {
-            cout << TTF_GetError() << endl;
-            cout << "TTF unable to create texture" << endl;
-            return;
+
+        node_t aux[4] = {
+            NewNode(sub[0], sub[1], sub[3], sub[4]),
+            NewNode(sub[1], sub[2], sub[4], sub[5]),
+            NewNode(sub[3], sub[4], sub[6], sub[7]),
+            NewNode(sub[4], sub[5], sub[7], sub[8])};
+        Advance(aux, 4, n.depth);
+        return NewNode(aux[0], aux[1], aux[2], aux[3]);
+    }
+
+    // Computes the next generation of the grid.
+    // Threads of a parallel step may compute the same result at once, which
+    // is harmless as hash-consing gives them the same handle; the result
+    // slot is read and written atomically for the other threads to see.
+    const node_t NextGeneration(node_t node) {
+        _QTreeNode_ &n = NodeList[node];
+        // The successor of a canonical node never changes
+        node_t result = __atomic_load_n(&n.result, __ATOMIC_ACQUIRE);
+        if (result != NIL) {
+            LocalHits++;
+            return result;
         }
+        LocalMisses++;
 
-        TextRect.x = 0;
-        TextRect.y = 0;
-        TextRect.w = TextSurface->w;
-        TextRect.h = TextSurface->h;
-        SDL_FreeSurface(TextSurface);
-        SDL_RenderCopy(renderer, TextTexture, NULL, &TextRect);
+        if (n.area == 0) result = CenteredSubNode(node);
+        else if (n.depth == 2) result = TheRules(node);
+        else if (n.depth == 4 && LeafKernel) result = LeafSuccessor(node);
+        else result = Successor(node);
+        __atomic_store_n(&n.result, result, __ATOMIC_RELEASE);
+        return result;
+    }
 
-        TTF_Quit();
+    // Returns the fraction of NextGeneration calls answered by the memo
+    const double CacheHitRate() {
+        long int total = CacheHits + CacheMisses;
+        return (total == 0) ? 0. : double(CacheHits) / total;
     }
 
-    void Quit() {
-        SDL_DestroyTexture(TextTexture);
-        Font = NULL;
-        TextRect = {};
-        TextSurface = NULL;
-        TextTexture = NULL;
+    // Forgets the memoized results that depend on the step size.
+    // Nodes of depth d <= min(old, new) + 2 advance the same either way.
+    void SetStep(int step) {
+        step = std::max(0, std::min(step, MAX_STEP));
+        int keep = std::min(step, STEP) + 2;
+        for (node_t node = 0; node < NodeList.size(); node++)
+            if (NodeList[node].depth > keep) NodeList[node].result = NIL;
+        STEP = step;
     }
-}
 
-namespace STATUS {
-    SDL_Point gridpos;
-    SDL_Point mousepos;
-    stringstream stream;
-    string mousewhere = "";
-    SDL_Rect ViewPort = {0, HEIGHT - 20, WIDTH, 20};
+    // Returns the bytes held by the node table and its index
+    const size_t MemoryUsage() {
+        return NodeList.capacity() * sizeof(_QTreeNode_) + TableBytes +
+               FreeList.capacity() * sizeof(node_t);
+    }
 
-    void RenderStatus(SDL_Renderer *renderer) {
-        SDL_RenderSetViewport(renderer, &ViewPort);
+    struct _QStats_ {
+        size_t nodes = 0;               // Live nodes
+        size_t bytes = 0;               // Bytes of the nodes and index
+        double load = 0.;               // Filled fraction of the index
+        double fragmentation = 0.;      // Free fraction of the used slots
+    };
 
-        stream.str(string()); // Clear the stream
+    // Measures the node table, to tell how big a pattern fits in memory
+    const _QStats_ Statistics() {
+        _QStats_ stats;
+        size_t indexed = 0, slots = 0;
+        for (_QIndexStripe_ &stripe : NodeIndex)
+            indexed += stripe.count, slots += stripe.slots.size();
+        stats.nodes = NodeList.size() - FreeList.size();
+        stats.bytes = MemoryUsage();
+        stats.load = slots ? double(indexed) / slots : 0.;
+        stats.fragmentation = double(FreeList.size()) / NodeList.size();
+        return stats;
+    }
+
+    // Sums up the collections of the run
+    void PrintCollections() {
+        if (Collections == 0) return;
+        cout << "GC: " << Collections << " collections freed " << Freed << " nodes in ";
+        cout << CollectingMs << " ms" << endl;
+    }
+
+    void PrintStatistics() {
+        _QStats_ stats = Statistics();
+        cout << "Nodes: " << stats.nodes << endl;
+        cout << "Memory: " << stats.bytes << " bytes, ";
+        cout << stats.bytes / std::max<size_t>(stats.nodes, 1) << " per node" << endl;
+        cout << "Load factor: " << stats.load << endl;
+        cout << "Fragmentation: " << stats.fragmentation << endl;
+        PrintCollections();
+    }
+
+    // Marks every node reachable from the roots.
+    // Following the memoized results keeps them warm for the next steps.
+    std::vector<bool> MarkNodes(bool results) {
+        std::vector<bool> marked(NodeList.size(), false);
+        std::vector<node_t> stack = {DEAD, ALIVE, Configuration};
+        stack.insert(stack.end(), Snapshots.begin(), Snapshots.end());
+        stack.insert(stack.end(), Canonical.begin(), Canonical.end());
+        {
+            std::lock_guard<std::mutex> lock(LibraryLock);
+            for (const auto &[name, pattern] : Library)
+                stack.insert(stack.end(), pattern.nodes.begin(), pattern.nodes.end());
+        }
+        while (!stack.empty()) {
+            node_t node = stack.back();
+            stack.pop_back();
+            if (node == NIL || marked[node]) continue;
+            marked[node] = true;
+            const _QTreeNode_ &n = NodeList[node];
+            if (n.depth == 0) continue;
+            stack.push_back(n.nw), stack.push_back(n.ne);
+            stack.push_back(n.sw), stack.push_back(n.se);
+            if (results) stack.push_back(n.result);
+        }
+        return marked;
+    }
+
+    // Frees every node that cannot be reached from the Configuration or
+    // the Snapshots. Memoized results are kept while the live nodes stay
+    // under half of the budget, and dropped otherwise.
+    void CollectGarbage() {
+        PROFILE_SCOPE("CollectGarbage");
+        auto start = std::chrono::steady_clock::now();
+        size_t before = MemoryUsage(), freed = 0;
+
+        std::vector<bool> marked = MarkNodes(true);
+        size_t live = 0;
+        for (bool m : marked) live += m;
+        // A live node costs its size and a few slots of the index
+        if (live * (sizeof(_QTreeNode_) + 3 * sizeof(node_t)) > MemoryBudget / 2)
+            marked = MarkNodes(false);
+
+        // Sweep the unmarked nodes into the free list
+        for (node_t node = 0; node < NodeList.size(); node++) {
+            _QTreeNode_ &n = NodeList[node];
+            if (n.depth < 0) continue;
+            if (!marked[node]) {
+                n.depth = -1, n.result = NIL;
+                freed++;
+            }
+            else if (n.result != NIL && !marked[n.result])
+                n.result = NIL;
+        }
+        // Compact the free slots at the end of the table
+        while (NodeList.back().depth < 0) NodeList.pop_back();
+        NodeList.shrink_to_fit();
+        FreeList.clear();
+        for (node_t node = 0; node < NodeList.size(); node++)
+            if (NodeList[node].depth < 0) FreeList.push_back(node);
+        FreeList.shrink_to_fit();
+        FreeCount = FreeList.size();
+
+        // Index the live nodes again, with each stripe at most half full
+        for (_QIndexStripe_ &stripe : NodeIndex) stripe.count = 0;
+        for (node_t node = DEAD; node < NodeList.size(); node++)
+            if (NodeList[node].depth > 0)
+                StripeOf(_QTreeHash_()(NodeList[node])).count++;
+        TableBytes = 0;
+        for (_QIndexStripe_ &stripe : NodeIndex) {
+            size_t size = 64;
+            while (size < stripe.count * 2) size *= 2;
+            stripe.slots.assign(size, NIL);
+            stripe.slots.shrink_to_fit();
+            TableBytes += size * sizeof(node_t);
+        }
+        for (node_t node = DEAD; node < NodeList.size(); node++) {
+            const _QTreeNode_ &n = NodeList[node];
+            if (n.depth <= 0) continue;
+            size_t hash = _QTreeHash_()(n);
+            _QIndexStripe_ &stripe = StripeOf(hash);
+            stripe.slots[Probe(stripe, n, hash)] = node;
+        }
+
+        Collected = MemoryUsage();
+        auto ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start);
+        Collections++, Freed += freed, CollectingMs += ms.count();
+        if (!VerboseGC) return;
+        // The index is sized anew, so the table can end up larger than
+        // before when few nodes were freed
+        cout << "GC: freed " << freed << " nodes (" << freed * sizeof(_QTreeNode_) << " bytes), ";
+        cout << "table " << before << " -> " << Collected << " bytes in ";
+        cout << ms.count() << " ms" << endl;
+    }
+
+    // Advances the configuration by 2^STEP generations
+    void NextGeneration();
+
+    // Advances the configuration to the target generation using the
+    // biggest steps up to 2^step that do not overshoot it, calling after
+    // (if given) once each step is done and stopping once it returns false
+    void AdvanceTo(uint64_t target, int step, const std::function<bool()> &after = nullptr) {
+        while (GENERATION < target) {
+            uint64_t remaining = target - GENERATION;
+            int k = std::min(step, int(log2(remaining)));
+            while ((uint64_t(1) << k) > remaining) k--;
+            if (k != STEP) SetStep(k);
+            NextGeneration();
+            if (after && !after()) break;
+        }
+    }
+
+    // The Configuration is the root of an unbounded universe. Every root
+    // is centered on the world origin, so its top left cell follows from
+    // its depth and stays put in the world as the root grows or shrinks.
+    const Vector2D<int64_t> Origin(node_t root) {
+        int64_t half = (NodeList[root].depth > 0) ? int64_t(1) << (NodeList[root].depth - 1) : 0;
+        return {-half, -half};
+    }
+
+    // A rectangle of world cells, [x0, x1) by [y0, y1)
+    struct _QRegion_ {
+        int64_t x0, y0, x1, y1;
+    };
+
+    // A node of a horizontal strip and the column of its left edge
+    struct _QPlaced_ {
+        node_t node;
+        int64_t x;
+    };
+
+    // Calls visit(y, row, words) for every row of the region holding live
+    // cells, top to bottom, where bit i of row (64 per word) is the cell
+    // x0 + i. The tree is walked a strip at a time, keeping only the live
+    // nodes of the strip that overlap the region, and the rows of a strip
+    // of depth 3 are packed from the bits of its nodes. The buffers are
+    // allocated once per call.
+    template <typename Visit>
+    void ForEachRow(node_t root, _QRegion_ region, Visit visit) {
+        PROFILE_SCOPE("ForEachRow");
+        Vector2D<int64_t> origin = Origin(root);
+        int depth = NodeList[root].depth;
+        int64_t size = int64_t(1) << depth;
+        // Nothing lies outside of the root
+        region.x0 = std::max(region.x0, origin.x), region.x1 = std::min(region.x1, origin.x + size);
+        region.y0 = std::max(region.y0, origin.y), region.y1 = std::min(region.y1, origin.y + size);
+        if (region.x0 >= region.x1 || region.y0 >= region.y1 || NodeList[root].area == 0) return;
+        size_t width = region.x1 - region.x0, words = (width + 63) / 64;
+        uint64_t tail = (width % 64) ? (uint64_t(1) << (width % 64)) - 1 : ~uint64_t(0);
+        std::vector<uint64_t> rows(8 * words);
+        std::vector<std::vector<_QPlaced_>> strips(depth + 1);
+        strips[depth].push_back({root, origin.x});
+
+        std::function<void(int, int64_t)> strip = [&](int d, int64_t y) {
+            if (d <= 3) {
+                // Pack the rows of the strip
+                int side = 1 << d;
+                std::fill(rows.begin(), rows.end(), 0);
+                for (const _QPlaced_ &p : strips[d]) {
+                    uint64_t mask = (uint64_t(1) << side) - 1;
+                    for (int r = 0; r < side; r++) {
+                        uint64_t bits = (NodeList[p.node].bits >> (r * side)) & mask;
+                        int64_t offset = p.x - region.x0;
+                        if (offset < 0) bits >>= -offset, offset = 0;
+                        if (!bits) continue;
+                        uint64_t *row = &rows[r * words];
+                        size_t word = offset / 64, shift = offset % 64;
+                        row[word] |= bits << shift;
+                        if (shift && word + 1 < words) row[word + 1] |= bits >> (64 - shift);
+                    }
+                }
+                for (int r = 0; r < side; r++) {
+                    if (y + r < region.y0 || y + r >= region.y1) continue;
+                    uint64_t *row = &rows[r * words];
+                    row[words - 1] &= tail;
+                    if (std::any_of(row, row + words, [](uint64_t w) { return w != 0; }))
+                        visit(y + r, (const uint64_t *)row, words);
+                }
+                return;
+            }
+            // Split the strip into its top and bottom halves
+            int64_t half = int64_t(1) << (d - 1);
+            for (int bottom = 0; bottom < 2; bottom++) {
+                int64_t top = y + bottom * half;
+                if (top >= region.y1 || top + half <= region.y0) continue;
+                std::vector<_QPlaced_> &next = strips[d - 1];
+                next.clear();
+                for (const _QPlaced_ &p : strips[d]) {
+                    const _QTreeNode_ &n = NodeList[p.node];
+                    node_t west = bottom ? n.sw : n.nw, east = bottom ? n.se : n.ne;
+                    if (NodeList[west].area && p.x < region.x1 && p.x + half > region.x0)
+                        next.push_back({west, p.x});
+                    if (NodeList[east].area && p.x + half < region.x1 && p.x + 2 * half > region.x0)
+                        next.push_back({east, p.x + half});
+                }
+                if (!next.empty()) strip(d - 1, top);
+            }
+        };
+        strip(depth, origin.y);
+    }
+
+    // Returns the smallest of sx * x + sy * y over the live cells of the
+    // node whose top left cell is (x, y), or best if none is smaller. The
+    // nodes that cannot beat best are skipped and the nearer quadrants are
+    // tried first, so mostly the edge of the pattern is descended. Repeats
+    // of a node are settled from least: its own smallest if it beat best,
+    // or else what it could not beat (exact being false).
+    typedef std::map<node_t, std::pair<int64_t, bool>> Least;
+    int64_t Edge(node_t node, int64_t x, int64_t y, int sx, int sy, int64_t best, Least &least) {
+        const _QTreeNode_ n = NodeList[node];
+        int64_t last = (int64_t(1) << n.depth) - 1, corner = sx * x + sy * y;
+        if (n.area == 0 || corner + std::min<int64_t>(0, sx * last) + std::min<int64_t>(0, sy * last) >= best)
+            return best;
+        auto known = least.find(node);
+        if (known != least.end()) {
+            auto [at, exact] = known->second;
+            if (exact) return std::min(best, corner + at);
+            if (corner + at >= best) return best;
+        }
+        int64_t found = best;
+        if (n.depth <= 3) {
+            int side = 1 << n.depth;
+            for (uint64_t bits = n.bits; bits; bits &= bits - 1) {
+                int b = __builtin_ctzll(bits);
+                found = std::min(found, corner + sx * (b % side) + sy * (b / side));
+            }
+        }
+        else {
+            // Rows first for the top and bottom, columns for the sides
+            static const int ROWS[4] = {0, 1, 2, 3}, COLUMNS[4] = {0, 2, 1, 3};
+            const node_t quadrants[4] = {n.nw, n.ne, n.sw, n.se};
+            const int *order = sy ? ROWS : COLUMNS;
+            int64_t half = (last + 1) / 2;
+            for (int i = 0; i < 4; i++) {
+                int q = (sx < 0 || sy < 0) ? order[3 - i] : order[i];
+                found = Edge(quadrants[q], x + (q & 1) * half, y + (q >> 1) * half, sx, sy, found, least);
+            }
+        }
+        least[node] = {found - corner, found < best};
+        return found;
+    }
+
+    // Returns the bounding box of the live cells of a root that has some
+    _QRegion_ Bounds(node_t root) {
+        const int64_t FAR = std::numeric_limits<int64_t>::max();
+        Vector2D<int64_t> origin = Origin(root);
+        auto edge = [&](int sx, int sy) {
+            Least least;
+            return Edge(root, origin.x, origin.y, sx, sy, FAR, least);
+        };
+        return {edge(1, 0), edge(0, 1), 1 - edge(-1, 0), 1 - edge(0, -1)};
+    }
+
+    // What a run has settled into
+    struct _QOutcome_ {
+        string kind = "";           // "empty", "still", "periodic", "linear" or "" if unsettled
+        uint64_t period = 0;        // Generations of a cycle, or between equal gains (a multiple of the step)
+        int64_t dx = 0, dy = 0;     // Displacement over a period
+        long int growth = 0;        // Cells gained every period of linear growth
+        uint64_t generation = 0;    // Generation it was found at
+    };
+
+    const node_t Window(node_t pattern, int64_t x, int64_t y, int depth);
+
+    // Watches the Configuration step by step for a state seen before, up to
+    // translation, or for a population gaining the same every period.
+    // A state is known by its shape, the node of its live cells moved to
+    // the top left of the smallest square holding them, which equal states
+    // share wherever they are. Shapes are only built for states of the
+    // same population and box, from the roots of the history, which are
+    // held as Snapshots so the collector cannot hand them to others.
+    class _QDetector_ {
+        struct _Sample_ {
+            uint64_t generation;
+            node_t root;
+            long int population;
+            int64_t x, y;               // Top left of the bounding box
+            int64_t width, height;
+        };
+        std::deque<_Sample_> history;   // Oldest first
+        const size_t HISTORY = 1024;
+        const int GAINS = 8;            // Equal gains in a row taken as linear growth
+        const int SMALL = 10;           // Depth of the roots whose rows are scanned
+
+        static void Release(node_t root) {
+            auto found = std::find(Snapshots.begin(), Snapshots.end(), root);
+            if (found != Snapshots.end()) Snapshots.erase(found);
+        }
+
+        _Sample_ Sample() {
+            _Sample_ sample = {GENERATION, Configuration, NodeList[Configuration].area, 0, 0, 0, 0};
+            if (sample.population == 0) return sample;
+            _QRegion_ box;
+            if (NodeList[Configuration].depth <= SMALL) {
+                // A small root is cheaper to scan row by row
+                const int64_t FAR = std::numeric_limits<int64_t>::max();
+                box = {FAR, FAR, -FAR, -FAR};
+                int64_t left = Origin(Configuration).x;
+                ForEachRow(Configuration, {-FAR, -FAR, FAR, FAR}, [&](int64_t y, const uint64_t *row, size_t words) {
+                    box.y0 = std::min(box.y0, y), box.y1 = y + 1;
+                    size_t first = 0, last = words - 1;
+                    while (!row[first]) first++;
+                    while (!row[last]) last--;
+                    box.x0 = std::min(box.x0, left + int64_t(first * 64 + __builtin_ctzll(row[first])));
+                    box.x1 = std::max(box.x1, left + int64_t(last * 64 + 64 - __builtin_clzll(row[last])));
+                });
+            }
+            else box = Bounds(Configuration);
+            sample.x = box.x0, sample.y = box.y0;
+            sample.width = box.x1 - box.x0, sample.height = box.y1 - box.y0;
+            return sample;
+        }
+
+        // The live cells of a sample moved to the top left of a square
+        static node_t Shape(const _Sample_ &sample) {
+            int depth = 0;
+            while ((int64_t(1) << depth) < std::max(sample.width, sample.height)) depth++;
+            Vector2D<int64_t> origin = Origin(sample.root);
+            return Window(sample.root, sample.x - origin.x, sample.y - origin.y, depth);
+        }
+
+        // Whether two samples are the same state up to translation
+        static bool Same(const _Sample_ &a, const _Sample_ &b) {
+            if (a.population != b.population || a.width != b.width || a.height != b.height) return false;
+            return a.root == b.root || Shape(a) == Shape(b);
+        }
+
+        // The generations after which a state repeats are the multiples of
+        // its period, so the smallest period of a state seen again after lag
+        // generations is the first divisor of lag it repeats after. Each is
+        // tried from the state itself, which the run is left at.
+        void Refine(const _Sample_ &now, const _Sample_ &before) {
+            uint64_t lag = now.generation - before.generation;
+            std::vector<uint64_t> divisors = {1};
+            for (uint64_t rest = lag, p = 2; rest > 1; p++) {
+                if (p * p > rest) p = rest;
+                size_t count = divisors.size();
+                for (uint64_t power = p; rest % p == 0; rest /= p, power *= p)
+                    for (size_t j = 0; j < count; j++) divisors.push_back(divisors[j] * power);
+            }
+            std::sort(divisors.begin(), divisors.end());
+
+            outcome.period = lag;
+            outcome.dx = now.x - before.x, outcome.dy = now.y - before.y;
+            int step = STEP;
+            Snapshots.push_back(now.root);
+            for (uint64_t period : divisors) {
+                if (period == lag) break;
+                AdvanceTo(now.generation + period, MAX_STEP);
+                _Sample_ later = Sample();
+                bool same = Same(later, now);
+                Configuration = now.root, GENERATION = now.generation;
+                if (!same) continue;
+                outcome.period = period;
+                outcome.dx = later.x - now.x, outcome.dy = later.y - now.y;
+                break;
+            }
+            Release(now.root);
+            if (STEP != step) SetStep(step);
+            bool still = (outcome.period == 1 && outcome.dx == 0 && outcome.dy == 0);
+            outcome.kind = still ? "still" : "periodic";
+            outcome.generation = before.generation;
+        }
+
+    public:
+        _QOutcome_ outcome;
+
+        ~_QDetector_() {
+            for (const _Sample_ &sample : history) Release(sample.root);
+        }
+
+        // Samples the Configuration and returns true once the run settled
+        bool Observe() {
+            _Sample_ now = Sample();
+            if (now.population == 0) {
+                outcome = {"empty", 1, 0, 0, 0, now.generation};
+                return true;
+            }
+            for (auto h = history.rbegin(); h != history.rend(); h++) {
+                if (!Same(*h, now)) continue;
+                Refine(now, *h);
+                return true;
+            }
+            history.push_back(now);
+            Snapshots.push_back(now.root);
+            if (history.size() > HISTORY) {
+                Release(history.front().root);
+                history.pop_front();
+            }
+            // The same gain in cells and in extent over the same number of
+            // generations, GAINS times. Streams that are eaten further on
+            // gain cells but not extent.
+            size_t n = history.size() - 1;
+            auto extent = [&](size_t k) { return history[k].width + history[k].height; };
+            for (size_t lag = 1; lag * GAINS <= n; lag++) {
+                uint64_t period = history[n].generation - history[n - lag].generation;
+                long int gain = history[n].population - history[n - lag].population;
+                int64_t spread = extent(n) - extent(n - lag);
+                if (gain <= 0 || spread <= 0) continue;
+                bool linear = true;
+                for (int k = 1; k < GAINS && linear; k++) {
+                    size_t a = n - k * lag, b = n - (k + 1) * lag;
+                    linear = (history[a].generation - history[b].generation == period &&
+                              history[a].population - history[b].population == gain &&
+                              extent(a) - extent(b) == spread);
+                }
+                if (!linear) continue;
+                outcome = {"linear", period, 0, 0, gain, history[n - GAINS * lag].generation};
+                return true;
+            }
+            return false;
+        }
+    };
+
+    // Grows the root once live cells leave its center half, which the
+    // padded root advances without losing them, or once the step needs a
+    // deeper root. Between the two the root keeps its size.
+    const node_t ExpandRoot(node_t root) {
+        while (NodeList[root].depth < STEP + 2 ||
+               NodeList[CenteredSubNode(root)].area != NodeList[root].area)
+            root = PadNode(root);
+        return root;
+    }
+
+    // Halves the root once its live cells fit in its center quarter. The
+    // gap between a quarter and a half keeps it from growing and shrinking
+    // on alternate steps.
+    const node_t ShrinkRoot(node_t root) {
+        while (NodeList[root].depth > STEP + 2 &&
+               NodeList[CenteredSubSubNode(root)].area == NodeList[root].area)
+            root = CenteredSubNode(root);
+        return root;
+    }
+
+    // Advances a root by 2^STEP generations, keeping it large enough
+    const node_t AdvanceRoot(node_t root) {
+        // The successor of the padded root is the root advanced 2^STEP
+        // generations, and of the same size
+        return ShrinkRoot(NextGeneration(PadNode(ExpandRoot(root))));
+    }
+
+    // Collect above the budget once the table has grown by half since
+    // the last collection, as collecting any sooner frees little. Under
+    // a hard cap collect by half of it, leaving the rest for the step.
+    // Either way the table grows by a chunk at least, or a budget below
+    // the live nodes would collect on every step.
+    void CollectOverBudget() {
+        size_t least = Collected + NodeList.chunk_bytes();
+        size_t limit = std::max({MemoryBudget, Collected + Collected / 2, least});
+        if (MemoryCap) limit = std::min(limit, std::max(MemoryCap / 2, least));
+        if (MemoryUsage() > limit)
+            CollectGarbage();
+    }
+
+    void NextGeneration() {
+        PROFILE_SCOPE("NextGeneration");
+        CollectOverBudget();
+        Configuration = AdvanceRoot(Configuration);
+        FlushCounters();
+        GENERATION += uint64_t(1) << STEP;  // Increase generations past
+        PROFILE_SAMPLE("Nodes", NodeList.size() - FreeCount);
+        PROFILE_SAMPLE("Memo", CacheHitRate());
+    }
+
+    // Returns the node of 2^depth cells whose top left corner is (x, y)
+    // in the node, or an empty one when it falls outside of it
+    const node_t SubNode(node_t node, int64_t x, int64_t y, int depth) {
+        int64_t side = int64_t(1) << NodeList[node].depth;
+        if (x < 0 || y < 0 || x >= side || y >= side)
+            return stack_C0000(depth);
+        while (NodeList[node].depth > depth) {
+            const _QTreeNode_ &n = NodeList[node];
+            int64_t half = int64_t(1) << (n.depth - 1);
+            if (y < half) node = (x < half) ? n.nw : n.ne;
+            else node = (x < half) ? n.sw : n.se;
+            x &= half - 1, y &= half - 1;
+        }
+        return node;
+    }
+
+    // Returns the 2^depth cells at (x, y) of the square of four nodes of
+    // that depth, where 0 <= x, y < 2^depth. The quadrants of the window
+    // lie at the same place in squares of the quadrants of the four, and
+    // the windows of 8x8 nodes or less are cut from their packed cells.
+    // As every square of a depth is shifted alike, shifted keeps the
+    // squares already done, and repeated parts are shifted once.
+    typedef std::map<std::array<node_t, 4>, node_t> Shifted;
+    const node_t Shift(node_t nw, node_t ne, node_t sw, node_t se, int64_t x, int64_t y, Shifted &shifted) {
+        const _QTreeNode_ NW = NodeList[nw], NE = NodeList[ne];
+        const _QTreeNode_ SW = NodeList[sw], SE = NodeList[se];
+        // An empty nw is the empty node of that depth
+        if ((x == 0 && y == 0) || NW.area + NE.area + SW.area + SE.area == 0) return nw;
+        auto done = shifted.find({nw, ne, sw, se});
+        if (done != shifted.end()) return done->second;
+        if (NW.depth <= 3) {
+            int side = 1 << NW.depth;
+            uint64_t mask = (uint64_t(1) << side) - 1, bits = 0;
+            for (int r = 0; r < side; r++) {
+                int row = r + y;
+                uint64_t west = (row < side) ? NW.bits : SW.bits, east = (row < side) ? NE.bits : SE.bits;
+                int at = (row % side) * side;
+                uint64_t line = ((west >> at) & mask) | ((east >> at) & mask) << side;
+                bits |= ((line >> x) & mask) << (r * side);
+            }
+            return shifted[{nw, ne, sw, se}] = NodeFromBits(bits, NW.depth);
+        }
+        const node_t grid[4][4] = {
+            {NW.nw, NW.ne, NE.nw, NE.ne}, {NW.sw, NW.se, NE.sw, NE.se},
+            {SW.nw, SW.ne, SE.nw, SE.ne}, {SW.sw, SW.se, SE.sw, SE.se}};
+        int64_t half = int64_t(1) << (NW.depth - 1);
+        node_t quadrants[4];
+        for (int q = 0; q < 4; q++) {
+            int col = (x + (q & 1) * half) / half, row = (y + (q >> 1) * half) / half;
+            quadrants[q] = Shift(grid[row][col], grid[row][col + 1], grid[row + 1][col], grid[row + 1][col + 1],
+                                 x % half, y % half, shifted);
+        }
+        return shifted[{nw, ne, sw, se}] = NewNode(quadrants[0], quadrants[1], quadrants[2], quadrants[3]);
+    }
+
+    // Returns the 2^depth cells at (x, y) of the pattern, which need not
+    // be aligned to its quadrants. Cells outside of the pattern are DEAD.
+    // Only the parts of the window over live cells are descended into.
+    const node_t Window(node_t pattern, int64_t x, int64_t y, int depth) {
+        int64_t size = int64_t(1) << depth;
+        int64_t side = int64_t(1) << NodeList[pattern].depth;
+        if (x >= side || y >= side || x + size <= 0 || y + size <= 0)
+            return stack_C0000(depth);
+        if (depth <= NodeList[pattern].depth) {
+            // The window lies in a square of four nodes aligned to its size
+            int64_t ax = x - (x % size + size) % size, ay = y - (y % size + size) % size;
+            Shifted shifted;
+            return Shift(SubNode(pattern, ax, ay, depth), SubNode(pattern, ax + size, ay, depth),
+                         SubNode(pattern, ax, ay + size, depth), SubNode(pattern, ax + size, ay + size, depth),
+                         x - ax, y - ay, shifted);
+        }
+        int64_t half = size / 2;
+        node_t nw = Window(pattern, x, y, depth - 1);
+        node_t ne = Window(pattern, x + half, y, depth - 1);
+        node_t sw = Window(pattern, x, y + half, depth - 1);
+        node_t se = Window(pattern, x + half, y + half, depth - 1);
+        return NewNode(nw, ne, sw, se);
+    }
+
+    // Returns the cells alive in either of two nodes of the same depth
+    const node_t Union(node_t a, node_t b) {
+        if (a == b || NodeList[b].area == 0) return a;
+        if (NodeList[a].area == 0) return b;
+        const _QTreeNode_ A = NodeList[a], B = NodeList[b];
+        if (A.depth == 0) return ALIVE;
+        node_t nw = Union(A.nw, B.nw), ne = Union(A.ne, B.ne);
+        node_t sw = Union(A.sw, B.sw), se = Union(A.se, B.se);
+        return NewNode(nw, ne, sw, se);
+    }
+
+    // Builds a quadtree bottom-up from live cells streamed row by row.
+    // Each level only holds the pair of node rows it is joining, kept
+    // sparse, so memory follows the live nodes and not the bounding box.
+    class _QBuilder_ {
+        typedef map<int64_t, node_t> _Row_;
+        struct _Pair_ {
+            int64_t index = -1;     // Index of the pair of rows, -1 if none
+            _Row_ rows[2];
+        };
+        std::vector<_Pair_> levels;
+        std::vector<node_t> empty;  // The empty node of each level
+        int64_t row = -1, width = 0;
+        _Row_ cells;                // Live cells of the current row
+
+        node_t Empty(int level) {
+            while (empty.size() <= level)
+                empty.push_back(empty.empty() ? DEAD :
+                    NewNode(empty.back(), empty.back(), empty.back(), empty.back()));
+            return empty[level];
+        }
+
+        // Adds a finished row of nodes to its level
+        void PushRow(int level, int64_t index, _Row_ &nodes) {
+            if (levels.size() <= level) levels.resize(level + 1);
+            if (levels[level].index != -1 && levels[level].index != index >> 1)
+                Join(level);
+            levels[level].index = index >> 1;
+            levels[level].rows[index & 1] = std::move(nodes);
+        }
+
+        // Joins the pair of rows of a level into a row of the level above
+        void Join(int level) {
+            node_t e = Empty(level);
+            map<int64_t, std::array<node_t, 4>> quads;
+            for (int half = 0; half < 2; half++) {
+                for (const auto &[x, n] : levels[level].rows[half]) {
+                    auto found = quads.find(x >> 1);
+                    if (found == quads.end())
+                        found = quads.insert({x >> 1, {e, e, e, e}}).first;
+                    found->second[half * 2 + (x & 1)] = n;
+                }
+                levels[level].rows[half].clear();
+            }
+            _Row_ joined;
+            for (const auto &[x, q] : quads)
+                joined[x] = NewNode(q[0], q[1], q[2], q[3]);
+            int64_t index = levels[level].index;
+            levels[level].index = -1;
+            PushRow(level + 1, index, joined);
+        }
+
+    public:
+        // Adds a live cell, rows must come in order from the top
+        void AddCell(int64_t x, int64_t y) {
+            if (x < 0 || y < row)
+                throw std::invalid_argument("Cells must be streamed in row order");
+            if (y > row) {
+                if (row >= 0) PushRow(0, row, cells);
+                cells.clear();
+                row = y;
+            }
+            cells[x] = ALIVE;
+            width = std::max(width, x + 1);
+        }
+
+        // Returns the node with the cells, its top left corner at 0, 0
+        node_t Finish() {
+            if (row < 0) return Empty(1);
+            PushRow(0, row, cells);
+            // The smallest depth that covers every cell
+            int depth = 1;
+            while ((int64_t(1) << depth) < std::max(width, row + 1)) depth++;
+            for (int level = 0; level < depth; level++)
+                if (levels[level].index != -1) Join(level);
+            auto found = levels[depth].rows[0].find(0);
+            return (found == levels[depth].rows[0].end()) ? Empty(depth) : found->second;
+        }
+    };
+
+    std::thread Indexer;                // Reads ./src/ ahead of the first use
+
+    // Joins the Indexer at exit if nothing waited for it
+    struct _QIndexerJoin_ {
+        ~_QIndexerJoin_() { if (Indexer.joinable()) Indexer.join(); }
+    } IndexerJoin;
+
+    // The orientation of a pattern turned by angle degrees and then
+    // flipped. A vertical flip is a horizontal one of the half turn.
+    int Orientation(int angle, int flip) {
+        int turns = (angle > 0) + (angle > 90) + (angle > 180);
+        if (flip == -1) return turns;
+        if (flip == P_HORIZONTAL) return 4 + turns;
+        if (flip == P_VERTICAL) return 4 + (turns + 2) % 4;
+        throw std::invalid_argument("Flip must be -1, 0, or 1.");
+    }
+
+    // Reads the cells of every pattern of the directory on a thread of its
+    // own. The nodes are still built on first use by the loading thread.
+    void IndexLibrary(string dir = "./src/") {
+        if (Indexer.joinable() || !std::filesystem::is_directory(dir)) return;
+        Indexer = std::thread([dir]() {
+            for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+                if (!entry.is_regular_file()) continue;
+                string name = entry.path().filename().string();
+                _QPattern_ pattern;
+                try { pattern.cells = ReadPattern::read_cells(name); }
+                catch (const std::exception &) { continue; }   // Reported on use
+                std::lock_guard<std::mutex> lock(LibraryLock);
+                Library.emplace(name, std::move(pattern));
+            }
+        });
+    }
+
+    // Returns the pattern with its node in the orientation, reading the
+    // pattern and building the node only the first time either is needed
+    const _QPattern_ &Pattern(string name, int orientation) {
+        std::unique_lock<std::mutex> lock(LibraryLock);
+        auto found = Library.find(name);
+        if (found == Library.end() && Indexer.joinable()) {
+            // It may be on its way
+            lock.unlock();
+            Indexer.join();
+            lock.lock();
+            found = Library.find(name);
+        }
+        if (found == Library.end()) {
+            _QPattern_ pattern;
+            pattern.cells = ReadPattern::read_cells(name);
+            found = Library.emplace(name, std::move(pattern)).first;
+        }
+        _QPattern_ &pattern = found->second;
+        if (pattern.nodes[orientation] == NIL) {
+            // Turn the cells clockwise, mirror them and stream them in rows
+            std::vector<std::pair<long int, long int>> cells;   // (y, x)
+            cells.reserve(pattern.cells.cells.size());
+            for (auto [x, y] : pattern.cells.cells) {
+                long int w = pattern.cells.w, h = pattern.cells.h;
+                for (int turn = 0; turn < orientation % 4; turn++) {
+                    std::tie(x, y) = std::make_pair(h - 1 - y, x);
+                    std::swap(w, h);
+                }
+                if (orientation >= 4) x = w - 1 - x;
+                cells.push_back({y, x});
+            }
+            std::sort(cells.begin(), cells.end());
+            _QBuilder_ builder;
+            for (const auto &[y, x] : cells) builder.AddCell(x, y);
+            pattern.nodes[orientation] = builder.Finish();
+        }
+        return pattern;
+    }
+
+    // Loads a pattern file (RLE, Life 1.06 or plaintext) straight into a
+    // node without going through a grid
+    void Load_Pattern_To_Node(string addr) {
+        PROFILE_SCOPE("Load_Pattern_To_Node");
+        string rule = ReadPattern::ReadRule(addr);
+        SetRule(ParseRule(rule == "" ? "B3/S23" : rule));
+        _QBuilder_ builder;
+        ReadPattern::ReadCells(addr, [&](long int x, long int y, long int n) {
+            for (long int i = 0; i < n; i++) builder.AddCell(x + i, y);
+        });
+        Configuration = builder.Finish();
+        cout << "[pattern] is ready" << endl;
+        cout << "Rule: " << RuleString(RULE) << endl;
+        // Remove excess borders from the configuration
+        Configuration = StripNode(Configuration);
+        cout << "Depth: " << NodeList[Configuration].depth << endl;
+        cout << "Area: " << NodeList[Configuration].area << endl;
+        cout << "Configuration: " << Configuration << endl;
+    }
+
+    // Loads and places the .config file in a node.
+    // Each pattern becomes a node once and is composed into the
+    // configuration at its offset, so no dense grid is ever built.
+    void Load_Config_To_Node(string addr) {
+        PROFILE_SCOPE("Load_Config_To_Node");
+        auto file = ReadPattern::Load_Config_File(addr);
+        if (file.w == 0 || file.h == 0)
+            throw std::invalid_argument("Missing [grid] in " + addr);
+        SetRule(ParseRule(file.rule));
+        cout << "[configuration] is ready" << endl;
+        cout << "Grid: w[" << file.w << "] h[" << file.h << "]" << endl;
+        cout << "Rule: " << RuleString(RULE) << endl;
+
+        // Each orientation of a pattern is a node of the Library
+        deque<std::array<int64_t, 3>> placed;   // Node, x and y on the grid
+        Vector2D<int64_t> low = {0, 0}, high = {file.w, file.h};
+        for (const ReadPattern::Placement &p : file.placements) {
+            int orientation = Orientation(p.angle, p.flip);
+            const _QPattern_ &pattern = Pattern(p.pattern, orientation);
+            if (pattern.cells.h == 0) continue;
+            // Get the size of the turned pattern
+            int64_t sx = pattern.cells.w, sy = pattern.cells.h;
+            if (orientation % 2) std::swap(sx, sy);
+            // Configure the start position of the pattern on the grid
+            Vector2D<int64_t> pos = {p.place.x - sx * p.anchor.x, p.place.y - sy * p.anchor.y};
+            placed.push_back({pattern.nodes[orientation], pos.x, pos.y});
+            low.x = std::min(low.x, pos.x), low.y = std::min(low.y, pos.y);
+            high.x = std::max(high.x, pos.x + sx), high.y = std::max(high.y, pos.y + sy);
+        }
+
+        // Center the grid on the smallest quadtree block that holds it...
+        // and grow the block until every pattern fits as well
+        int depth = 1;
+        Vector2D<int64_t> shift;
+        while (true) {
+            int64_t k = int64_t(1) << depth;
+            shift.x = (k - file.w) / 2, shift.y = (k - file.h) / 2;
+            if (shift.x + low.x >= 0 && shift.y + low.y >= 0 &&
+                shift.x + high.x <= k && shift.y + high.y <= k) break;
+            depth++;
+        }
+        cout << "Quadtree: " << (int64_t(1) << depth) << endl;
+
+        // Compose the patterns into the configuration
+        Configuration = stack_C0000(depth);
+        for (const auto &[node, x, y] : placed)
+            Configuration = Union(Configuration, Window(node, -(shift.x + x), -(shift.y + y), depth));
+        // Remove excess borders from the configuration
+        Configuration = StripNode(Configuration);
+        cout << "Depth: " << NodeList[Configuration].depth << endl;
+        cout << "Area: " << NodeList[Configuration].area << endl;
+        cout << "Configuration: " << Configuration << endl;
+    }
+
+    // A snapshot file is the header followed by the nodes reachable from
+    // the root, children before parents. A child is 0 or 1 for the DEAD and
+    // ALIVE cells and k + 2 for the k-th node of the file. Integers are
+    // stored in the byte order of the machine.
+    struct _QSnapshotHeader_ {
+        char magic[8];          // "HASHLIFE"
+        uint32_t version;
+        uint32_t nodes;         // Nodes after the header
+        uint64_t generation;
+        uint32_t root;          // Index of the root
+        uint16_t birth, survival;
+    };
+    struct _QSnapshotNode_ {
+        uint32_t nw, ne, sw, se;
+    };
+    const uint32_t SNAPSHOT_VERSION = 1;
+
+    // Writes the root, the nodes under it, the generation and the rule.
+    // The file is written aside and renamed over addr once complete, so a
+    // crash never leaves a partial snapshot behind.
+    void Save_Snapshot(string addr, node_t root, uint64_t generation) {
+        PROFILE_SCOPE("Save_Snapshot");
+        // Number the nodes in post-order so children come first
+        std::vector<uint32_t> index(NodeList.size(), NIL);
+        std::vector<_QSnapshotNode_> nodes;
+        index[DEAD] = 0, index[ALIVE] = 1;
+        std::vector<node_t> stack = {root};
+        while (!stack.empty()) {
+            node_t node = stack.back();
+            if (index[node] != NIL) {
+                stack.pop_back();
+                continue;
+            }
+            const _QTreeNode_ &n = NodeList[node];
+            bool ready = true;
+            for (node_t child : {n.se, n.sw, n.ne, n.nw})
+                if (index[child] == NIL) stack.push_back(child), ready = false;
+            if (!ready) continue;
+            stack.pop_back();
+            index[node] = nodes.size() + 2;
+            nodes.push_back({index[n.nw], index[n.ne], index[n.sw], index[n.se]});
+        }
+
+        _QSnapshotHeader_ header = {
+            {'H', 'A', 'S', 'H', 'L', 'I', 'F', 'E'}, SNAPSHOT_VERSION,
+            uint32_t(nodes.size()), generation, index[root], RULE.birth, RULE.survival};
+        string partial = addr + ".part";
+        std::ofstream file(partial, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file) throw std::invalid_argument("Unable to write " + partial);
+        file.write((const char *)&header, sizeof(header));
+        file.write((const char *)nodes.data(), nodes.size() * sizeof(_QSnapshotNode_));
+        file.close();
+        if (!file || std::rename(partial.c_str(), addr.c_str()) != 0)
+            throw std::invalid_argument("Unable to write " + addr);
+        cout << "[snapshot] saved " << nodes.size() << " nodes to " << addr << endl;
+    }
+
+    // Maps a snapshot file into memory and adopts its nodes as they are,
+    // each one a single NewNode of nodes already made
+    void Load_Snapshot_To_Node(string addr) {
+        PROFILE_SCOPE("Load_Snapshot_To_Node");
+        int fd = open(addr.c_str(), O_RDONLY);
+        if (fd < 0) throw std::invalid_argument("Unable to open " + addr);
+        struct stat info;
+        if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(_QSnapshotHeader_)) {
+            close(fd);
+            throw std::invalid_argument("Not a snapshot: " + addr);
+        }
+        size_t size = info.st_size;
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) throw std::invalid_argument("Unable to map " + addr);
+        madvise(data, size, MADV_SEQUENTIAL);
+
+        try {
+            const _QSnapshotHeader_ &header = *(const _QSnapshotHeader_ *)data;
+            const _QSnapshotNode_ *nodes = (const _QSnapshotNode_ *)(&header + 1);
+            if (string(header.magic, 8) != "HASHLIFE" || header.version != SNAPSHOT_VERSION ||
+                size != sizeof(header) + size_t(header.nodes) * sizeof(_QSnapshotNode_) ||
+                header.root >= header.nodes + 2)
+                throw std::invalid_argument("Not a snapshot: " + addr);
+            _QRule_ rule;
+            rule.birth = header.birth, rule.survival = header.survival;
+            SetRule(rule);
+
+            std::vector<node_t> handles(header.nodes + 2);
+            handles[0] = DEAD, handles[1] = ALIVE;
+            for (uint32_t k = 0; k < header.nodes; k++) {
+                const _QSnapshotNode_ &n = nodes[k];
+                // Children come first, which also rules out cycles
+                if (std::max({n.nw, n.ne, n.sw, n.se}) >= k + 2)
+                    throw std::invalid_argument("Corrupt snapshot: " + addr);
+                handles[k + 2] = NewNode(handles[n.nw], handles[n.ne], handles[n.sw], handles[n.se]);
+            }
+            Configuration = handles[header.root];
+            GENERATION = header.generation;
+        }
+        catch (...) {
+            munmap(data, size);
+            throw;
+        }
+        munmap(data, size);
+        cout << "[snapshot] is ready" << endl;
+        cout << "Rule: " << RuleString(RULE) << endl;
+        cout << "Generation: " << GENERATION << endl;
+        cout << "Depth: " << NodeList[Configuration].depth << endl;
+        cout << "Area: " << NodeList[Configuration].area << endl;
+    }
+}
+
+namespace Benchmark {
+    typedef std::chrono::steady_clock Clock;
+
+    // Builds distinct depth-3 nodes from random depth-2 quadrants, so that
+    // nearly every NewNode adds a node to the table
+    class _QRandomNodes_ {
+        deque<GameOfLife::node_t> quads;
+        unsigned long long seed = 0x2545F4914F6CDD1DULL;
+
+    public:
+        _QRandomNodes_() {
+            using namespace GameOfLife;
+            deque<node_t> canon;
+            // The 16 canonical nodes and every depth-2 node made from them
+            for (int b = 0; b < 16; b++)
+                canon.push_back(NewNode(b >> 3 & 1, b >> 2 & 1, b >> 1 & 1, b & 1));
+            for (int b = 0; b < 65536; b++)
+                quads.push_back(NewNode(
+                    canon[b >> 12 & 15], canon[b >> 8 & 15],
+                    canon[b >> 4 & 15], canon[b & 15]));
+        }
+
+        // Builds count nodes and returns the nanoseconds per NewNode
+        double Time(long int count) {
+            auto start = Clock::now();
+            for (long int x = 0; x < count; x++) {
+                seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+                GameOfLife::NewNode(
+                    quads[seed & 0xFFFF], quads[seed >> 16 & 0xFFFF],
+                    quads[seed >> 32 & 0xFFFF], quads[seed >> 48 & 0xFFFF]);
+            }
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+            return double(ns.count()) / count;
+        }
+    };
+
+    // Measures the throughput of NewNode as the node table grows.
+    // Each batch is timed so the cost per node can be compared over size.
+    void NodeCreation(long int total) {
+        using namespace GameOfLife;
+        _QRandomNodes_ nodes;
+        const long int batch = 1 << 16;
+        cout << "nodes\tns/NewNode" << endl;
+        for (long int made = 0, round = 1; made < total; round++) {
+            double ns = nodes.Time(batch);
+            made += batch;
+            // Report on powers of two to keep the table short
+            if ((round & (round - 1)) == 0 || made >= total)
+                cout << NodeList.size() << "\t" << ns << endl;
+        }
+    }
+
+    // Steps a configuration or pattern and reports the memo hit rate per
+    // window. Periodic patterns should settle to a rate close to one.
+    void MemoCache(string addr, bool config, long int total, long int window) {
+        using namespace GameOfLife;
+        if (config) Load_Config_To_Node(addr);
+        else Load_Pattern_To_Node(addr);
+        cout << "generation\thits\tmisses\thit rate" << endl;
+        for (long int made = 0; made < total; made += window) {
+            long int hits = CacheHits, misses = CacheMisses;
+            for (long int x = 0; x < window; x++)
+                NextGeneration();
+            hits = CacheHits - hits, misses = CacheMisses - misses;
+            cout << GENERATION << "\t" << hits << "\t" << misses << "\t";
+            cout << double(hits) / std::max(1L, hits + misses) << endl;
+        }
+    }
+
+    // Compares the generations per second of the 16x16 leaf kernel with
+    // the recursion down to TheRules. Both start from the loaded
+    // configuration with an empty memo and the nodes of the other one
+    // collected, and advance one generation a step.
+    void Kernel(string addr, bool config, long int total) {
+        using namespace GameOfLife;
+        if (config) Load_Config_To_Node(addr);
+        else Load_Pattern_To_Node(addr);
+        const node_t start = Configuration;
+        const uint64_t generation = GENERATION;
+        Snapshots.push_back(start);
+        cout << "base case\tgenerations/s\tnodes" << endl;
+        for (bool kernel : {false, true}) {
+            LeafKernel = kernel;
+            Configuration = start, GENERATION = generation;
+            for (node_t node = 0; node < NodeList.size(); node++)
+                NodeList[node].result = NIL;
+            CollectGarbage();
+            auto begin = Clock::now();
+            AdvanceTo(generation + total, 0);
+            std::chrono::duration<double> s = Clock::now() - begin;
+            cout << (kernel ? "leaf 16x16" : "TheRules") << "\t";
+            cout << total / s.count() << "\t" << NodeList.size() - FreeList.size() << endl;
+        }
+        Snapshots.pop_back();
+    }
+
+    // Times the same run on 1, 2, 4... up to the given number of threads.
+    // Each run starts from the loaded configuration with the results
+    // cleared and the other nodes collected, so none reuses another's work.
+    void Threads(string addr, uint64_t total, int threads) {
+        using namespace GameOfLife;
+        Load_Config_To_Node(addr);
+        const node_t start = Configuration;
+        const uint64_t generation = GENERATION;
+        Snapshots.push_back(start);
+        double single = 0.;
+        cout << "threads\tms\tspeedup\tnodes" << endl;
+        std::vector<int> counts;
+        for (int t = 1; t < threads; t *= 2) counts.push_back(t);
+        counts.push_back(threads);
+        for (int t : counts) {
+            Configuration = start, GENERATION = generation;
+            for (node_t node = 0; node < NodeList.size(); node++)
+                NodeList[node].result = NIL;
+            CollectGarbage();
+            SetThreads(t);
+            auto begin = Clock::now();
+            AdvanceTo(generation + total, MAX_STEP);
+            std::chrono::duration<double, std::milli> ms = Clock::now() - begin;
+            if (t == 1) single = ms.count();
+            cout << t << "\t" << ms.count() << "\t" << single / ms.count() << "\t";
+            cout << NodeList.size() - FreeList.size() << endl;
+        }
+        SetThreads(1);
+        Snapshots.pop_back();
+    }
+
+    // The patterns of ./src/ the suite runs besides every configuration
+    const std::vector<string> SUITE_PATTERNS = {
+        "Gosper Glider Gun p30", "Glider Reflector", "Lightweight Spaceship Factory p46 f23"};
+    // Generations the suite reports at, stepping one at a time as the window does
+    const std::vector<uint64_t> SUITE_GENERATIONS = {100, 1000, 10000};
+
+    // Times NewNode on a copy of the process, so the nodes it adds never
+    // reach the table of the run. Returns the nanoseconds per node.
+    double ForkedNewNode(long int count) {
+        int fds[2];
+        if (pipe(fds) != 0) throw std::runtime_error("Unable to open a pipe");
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            _QRandomNodes_ nodes;
+            double ns = nodes.Time(count);
+            _exit(write(fds[1], &ns, sizeof(ns)) == sizeof(ns) ? 0 : 1);
+        }
+        close(fds[1]);
+        double ns = 0.;
+        if (pid < 0 || read(fds[0], &ns, sizeof(ns)) != sizeof(ns)) ns = 0.;
+        close(fds[0]);
+        if (pid > 0) waitpid(pid, nullptr, 0);
+        return ns;
+    }
+
+    // Loads one input of the suite and returns its rows: the load at
+    // generation 0, then one row per reported generation. NewNode is
+    // timed at each row on the table as it is then, off the clock.
+    string SuiteRun(string name, string addr, bool config) {
+        using namespace GameOfLife;
+        stringstream rows;
+        size_t peak = 0;
+        auto row = [&](uint64_t generation, double ms) {
+            double ns = ForkedNewNode(1 << 14);
+            struct rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            peak = std::max(peak, NodeList.size() - FreeCount);
+            rows << name << "\t" << generation << "\t" << ms << "\t";
+            rows << (ms > 0. && generation ? generation / ms * 1000. : 0.) << "\t";
+            rows << ns << "\t" << peak << "\t" << usage.ru_maxrss << "\n";
+        };
+        auto begin = Clock::now();
+        try {
+            if (config) Load_Config_To_Node(addr);
+            else Load_Pattern_To_Node(addr);
+        }
+        catch (const std::invalid_argument &e) {
+            // Not an input the engine runs
+            return "# " + name + " skipped: " + e.what() + "\n";
+        }
+        // An empty universe would only time the stepping of nothing
+        if (NodeList[Configuration].area == 0)
+            throw std::runtime_error("loads with no live cells");
+        std::chrono::duration<double, std::milli> load = Clock::now() - begin;
+        row(0, load.count());
+
+        SetStep(0);
+        double ms = 0.;
+        for (uint64_t target : SUITE_GENERATIONS) {
+            begin = Clock::now();
+            while (GENERATION < target) {
+                NextGeneration();
+                peak = std::max(peak, NodeList.size() - FreeCount);
+            }
+            ms += std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+            row(target, ms);
+        }
+        return rows.str();
+    }
+
+    // Runs every configuration of ./config/ and the SUITE_PATTERNS, each in
+    // a process of its own so that it starts from an empty node table and
+    // its peak RSS is its own. The rows are tab separated, to be compared
+    // across commits, and go to cout and the file.
+    int Suite(string out) {
+        std::vector<std::pair<string, string>> inputs;  // Name and path
+        if (std::filesystem::is_directory("./config/"))
+            for (const auto &entry : std::filesystem::directory_iterator("./config/"))
+                if (entry.is_regular_file())
+                    inputs.push_back({entry.path().filename().string(), entry.path().string()});
+        std::sort(inputs.begin(), inputs.end());
+        size_t configs = inputs.size();
+        for (const string &name : SUITE_PATTERNS)
+            inputs.push_back({name, "./src/" + name});
+
+        std::ofstream file(out, std::ios::out | std::ios::trunc);
+        if (!file) throw std::invalid_argument("Unable to write " + out);
+        const string header = "input\tgeneration\tms\tgenerations/s\tns/NewNode\tpeak nodes\tpeak RSS KB";
+        cout << header << endl;
+        file << header << endl;
+        int failed = 0;
+        for (size_t x = 0; x < inputs.size(); x++) {
+            const auto &[name, addr] = inputs[x];
+            int fds[2];
+            if (pipe(fds) != 0) throw std::runtime_error("Unable to open a pipe");
+            cout.flush();
+            pid_t pid = fork();
+            if (pid == 0) {
+                // Keep the progress of the loaders out of the table
+                close(fds[0]);
+                cout.setstate(std::ios::failbit);
+                try {
+                    string rows = SuiteRun(name, addr, x < configs);
+                    if (write(fds[1], rows.data(), rows.size()) != ssize_t(rows.size())) _exit(1);
+                    _exit(0);
+                }
+                catch (const std::exception &e) {
+                    // The reason goes in place of the rows
+                    string reason = e.what();
+                    (void)!write(fds[1], reason.data(), reason.size());
+                    _exit(1);
+                }
+            }
+            close(fds[1]);
+            string rows;
+            char buffer[4096];
+            for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0;)
+                rows.append(buffer, n);
+            close(fds[0]);
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                string note = "# " + name + " failed" + (rows != "" ? ": " + rows : "");
+                cout << note << endl;
+                file << note << endl;
+                failed++;
+                continue;
+            }
+            cout << rows << std::flush;
+            file << rows << std::flush;
+        }
+        return failed ? 1 : 0;
+    }
+}
+
+namespace Headless {
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double, std::milli> Millis;
+
+    string Checkpoint = "";             // Snapshot file kept up to date, none if empty
+    uint64_t CheckpointEvery = 0;       // Generations between checkpoints, 0 for none
+    double CheckpointSeconds = 0.;      // Seconds between checkpoints, 0 for none
+    bool Detect = false;                // Stop once the run is still, periodic or linear
+    const int DETECT_STEP = 3;          // Step of detecting runs without --step
+
+    // Writes snapshots of the run on a thread of their own. The root of a
+    // checkpoint is immutable, so it only has to be kept from the collector
+    // while it is written; stepping goes on meanwhile.
+    namespace Checkpoints {
+        std::thread Writer;
+        std::atomic<bool> Writing{false};
+        GameOfLife::node_t Root = GameOfLife::NIL;
+        int Written = 0, Skipped = 0;
+        uint64_t Generation = std::numeric_limits<uint64_t>::max();  // Of the last one written
+        double Stepping = 0.;           // Milliseconds the stepping thread spent
+        std::atomic<long int> Background{0};    // Microseconds spent writing
+
+        // Joins the last writer and lets the collector have its root
+        void Finish() {
+            using namespace GameOfLife;
+            if (Writer.joinable()) Writer.join();
+            if (Root == NIL) return;
+            auto found = std::find(Snapshots.begin(), Snapshots.end(), Root);
+            if (found != Snapshots.end()) Snapshots.erase(found);
+            Root = NIL;
+        }
+
+        // Writes the current configuration, skipping it while the last one is
+        // still going unless told to wait for that one
+        void Save(bool wait = false) {
+            using namespace GameOfLife;
+            auto start = Clock::now();
+            if (Writing && !wait) {
+                Skipped++;
+                return;
+            }
+            Finish();
+            Root = Configuration, Generation = GENERATION;
+            Snapshots.push_back(Root);
+            Writing = true;
+            Writer = std::thread([root = Root, generation = GENERATION]() {
+                auto begin = Clock::now();
+                try { Save_Snapshot(Checkpoint, root, generation); }
+                catch (const std::exception &e) { cout << e.what() << endl; }
+                Background += std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - begin).count();
+                Writing = false;
+            });
+            Written++;
+            Stepping += Millis(Clock::now() - start).count();
+        }
+    }
+
+    // Advances the loaded configuration without SDL and prints a summary
+    int Run(uint64_t target, int step) {
+        using namespace GameOfLife;
+        auto start = Clock::now();
+        // Checkpoint once a multiple of the interval or the time has passed
+        uint64_t next = CheckpointEvery ? GENERATION + CheckpointEvery : 0;
+        auto last = start;
+        _QDetector_ detector;
+        bool settled = false;
+        auto after = [&]() {
+            if (Detect && detector.Observe()) return !(settled = true);
+            if (Checkpoint == "") return true;
+            bool boundary = CheckpointEvery && GENERATION >= next;
+            bool due = boundary || (CheckpointSeconds > 0. &&
+                                    Millis(Clock::now() - last).count() >= CheckpointSeconds * 1000.);
+            if (!due) return true;
+            Checkpoints::Save(boundary);
+            last = Clock::now();
+            if (CheckpointEvery) next = (GENERATION / CheckpointEvery + 1) * CheckpointEvery;
+            return true;
+        };
+        int status = 0;
+        try {
+            if (Detect) settled = detector.Observe();
+            // Steps never cross the next multiple of the interval, so every
+            // one of them is checkpointed
+            while (!settled && GENERATION < target) {
+                bool every = (Checkpoint != "" && CheckpointEvery);
+                AdvanceTo(every ? std::min(target, next) : target, step, after);
+            }
+        }
+        catch (const std::length_error &e) {
+            // Report how far the run got within the cap
+            cout << "Stopped: " << e.what() << endl;
+            status = 1;
+        }
+        // The last state is checkpointed too, unless it just was
+        if (Checkpoint != "" && Checkpoints::Generation != GENERATION) Checkpoints::Save(true);
+        Checkpoints::Finish();
+        auto ms = Millis(Clock::now() - start);
+        cout << "Generation: " << GENERATION << endl;
+        cout << "Area: " << NodeList[Configuration].area << endl;
+        cout << "Depth: " << NodeList[Configuration].depth << endl;
+        PrintStatistics();
+        cout << "Time: " << ms.count() << " ms" << endl;
+        if (Profile::ENABLED) Profile::PrintTotals();
+        const _QOutcome_ &outcome = detector.outcome;
+        if (outcome.kind != "") {
+            cout << "Outcome: " << outcome.kind << " from generation " << outcome.generation;
+            if (outcome.kind == "periodic" || outcome.kind == "linear")
+                cout << ", period " << outcome.period;
+            if (outcome.kind == "periodic")
+                cout << ", displacement " << outcome.dx << ", " << outcome.dy;
+            if (outcome.kind == "linear")
+                cout << ", " << outcome.growth << " cells a period";
+            cout << endl;
+        }
+        else if (Detect) cout << "Outcome: unsettled" << endl;
+        if (Checkpoint != "") {
+            // What the checkpoints took from the run, and what ran beside it
+            cout << "Checkpoints: " << Checkpoints::Written << " written, ";
+            cout << Checkpoints::Skipped << " skipped while writing" << endl;
+            cout << "Checkpoint cost: " << Checkpoints::Stepping << " ms stepping (";
+            cout << 100. * Checkpoints::Stepping / std::max(ms.count(), 1e-9) << "%), ";
+            cout << Checkpoints::Background / 1000. << " ms writing alongside" << endl;
+        }
+        return status;
+    }
+}
+
+// Runs many configurations in one process. They are stepped side by side
+// on the Pool and share the node table and the memoized results, so the
+// parts they have in common, such as the same guns and eaters, are built
+// and advanced once for all of them.
+namespace Batch {
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<double, std::milli> Millis;
+
+    struct _QRun_ {
+        string name, addr;
+        GameOfLife::_QRule_ rule;
+        GameOfLife::node_t root = GameOfLife::NIL;
+        long int population = -1;       // After the batch, -1 if it did not load
+        double alone = 0.;              // Milliseconds when run on its own
+        long int expected = -1;         // Population when run on its own
+    };
+
+    // The files given and the files of the directories given, in order
+    std::vector<_QRun_> Inputs(const std::vector<string> &paths) {
+        std::vector<_QRun_> runs;
+        for (const string &path : paths) {
+            std::vector<string> files;
+            if (std::filesystem::is_directory(path)) {
+                for (const auto &entry : std::filesystem::directory_iterator(path))
+                    if (entry.is_regular_file()) files.push_back(entry.path().string());
+                std::sort(files.begin(), files.end());
+            }
+            else files.push_back(path);
+            for (const string &file : files) {
+                _QRun_ run;
+                run.name = std::filesystem::path(file).filename().string();
+                run.addr = file;
+                runs.push_back(run);
+            }
+        }
+        return runs;
+    }
+
+    // Runs a configuration on its own in a fresh process, as it would be
+    // run separately, and fills in its time, process included, and its
+    // population
+    void RunAlone(_QRun_ &run, uint64_t target, int step) {
+        int fds[2];
+        if (pipe(fds) != 0) throw std::runtime_error("Unable to open a pipe");
+        cout.flush();
+        auto start = Clock::now();
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            cout.setstate(std::ios::failbit);
+            long int population = -1;
+            try {
+                GameOfLife::Load_Config_To_Node(run.addr);
+                GameOfLife::AdvanceTo(target, step);
+                population = GameOfLife::NodeList[GameOfLife::Configuration].area;
+            }
+            catch (const std::exception &) {}
+            _exit(write(fds[1], &population, sizeof(population)) == sizeof(population) ? 0 : 1);
+        }
+        close(fds[1]);
+        if (pid < 0 || read(fds[0], &run.expected, sizeof(run.expected)) != sizeof(run.expected))
+            run.expected = -1;
+        close(fds[0]);
+        if (pid > 0) waitpid(pid, nullptr, 0);
+        run.alone = Millis(Clock::now() - start).count();
+    }
+
+    // Loads every configuration, then steps the ones of each rule together
+    // to the target generation, a step of every run at a time across the
+    // threads. Prints a row per configuration and the speedup over running
+    // each on its own, which is measured first.
+    int Run(const std::vector<string> &paths, uint64_t target, int step, int threads) {
+        using namespace GameOfLife;
+        std::vector<_QRun_> runs = Inputs(paths);
+        double alone = 0.;
+        for (_QRun_ &run : runs) {
+            RunAlone(run, target, step);
+            alone += run.alone;
+        }
+
+        auto start = Clock::now();
+        SetThreads(threads);
+        // Load quietly, the common patterns become nodes once
+        cout.setstate(std::ios::failbit);
+        for (_QRun_ &run : runs) {
+            try { Load_Config_To_Node(run.addr); }
+            catch (const std::invalid_argument &) { continue; }
+            run.rule = RULE, run.root = Configuration;
+            Snapshots.push_back(run.root);
+        }
+        cout.clear();
+
+        // The results depend on the rule, so each rule is a group of its own
+        std::vector<_QRule_> rules;
+        for (const _QRun_ &run : runs)
+            if (run.root != NIL && std::find(rules.begin(), rules.end(), run.rule) == rules.end())
+                rules.push_back(run.rule);
+        std::vector<_QRun_ *> group;
+        try {
+            for (const _QRule_ &rule : rules) {
+                SetRule(rule);
+                group.clear();
+                for (_QRun_ &run : runs)
+                    if (run.root != NIL && run.rule == rule) group.push_back(&run);
+                for (uint64_t generation = 0; generation < target;) {
+                    uint64_t remaining = target - generation;
+                    int k = std::min(step, int(log2(remaining)));
+                    while ((uint64_t(1) << k) > remaining) k--;
+                    if (k != STEP) SetStep(k);
+                    // Only between steps, with every root held
+                    Snapshots.clear();
+                    for (const _QRun_ &run : runs) Snapshots.push_back(run.root);
+                    CollectOverBudget();
+                    auto advance = [&](int x) { group[x]->root = AdvanceRoot(group[x]->root); };
+                    if (Threads > 1) Pool.ForEach(group.size(), advance);
+                    else for (int x = 0; x < int(group.size()); x++) advance(x);
+                    FlushCounters();
+                    generation += uint64_t(1) << k;
+                }
+            }
+        }
+        catch (const std::length_error &e) {
+            cout << "Stopped: " << e.what() << endl;
+            SetThreads(1);
+            return 1;
+        }
+        double batch = Millis(Clock::now() - start).count();
+        int used = Threads;
+        SetThreads(1);
+
+        int status = 0;
+        cout << "configuration\trule\tpopulation\talone ms\tmatch" << endl;
+        for (_QRun_ &run : runs) {
+            if (run.root == NIL) {
+                cout << "# " << run.name << " skipped" << endl;
+                continue;
+            }
+            run.population = NodeList[run.root].area;
+            bool match = (run.population == run.expected);
+            if (!match) status = 1;
+            cout << run.name << "\t" << RuleString(run.rule) << "\t" << run.population << "\t";
+            cout << run.alone << "\t" << (match ? "yes" : "NO") << endl;
+        }
+        cout << "Generations: " << target << endl;
+        cout << "Alone: " << alone << " ms in " << runs.size() << " processes" << endl;
+        cout << "Batch: " << batch << " ms on " << used << " threads, ";
+        cout << rules.size() << " rules" << endl;
+        cout << "Speedup: " << alone / std::max(batch, 1e-9) << endl;
+        PrintStatistics();
+        return status;
+    }
+}
+
+namespace Simulation {
+    struct _QSnapshot_ {
+        GameOfLife::node_t root = GameOfLife::DEAD;
+        uint64_t generation = 0;
+        int step = 0;
+        double memo = 0.;
+        size_t bytes = 0;                   // Memory of the node table
+        size_t nodes = 0;                   // Live nodes of the table
+        double rate = 0.;                   // Smoothed generations per second
+    };
+
+    // Triple buffer: the worker fills Buffer[Back], the renderer reads
+    // Buffer[Front], and they trade the Middle slot with an atomic exchange
+    _QSnapshot_ Buffer[3];
+    const int FRESH = 4;                    // Marks a Middle slot not yet read
+    std::atomic<int> Middle{1};
+    int Back = 0, Front = 2;
+
+    std::atomic<bool> Running{false}, Paused{false};
+    std::atomic<int> Step{0};               // Requested step, applied by the worker
+    std::atomic<double> Speed{30.};         // Target generations per second, 0 is unbounded
+    std::thread Worker;
+    double Rate = 0.;                       // Generations per second, worker only
+
+    // Publishes the current configuration for the renderer
+    void Publish() {
+        using namespace GameOfLife;
+        Buffer[Back] = {Configuration, GENERATION, STEP, CacheHitRate(), MemoryUsage(),
+                        NodeList.size() - FreeCount, Rate};
+        Back = Middle.exchange(Back | FRESH) & 3;
+        // Keep every root the renderer might still be drawing
+        Snapshots = {Buffer[0].root, Buffer[1].root, Buffer[2].root};
+    }
+
+    // Returns the latest published snapshot without blocking
+    const _QSnapshot_ &Acquire() {
+        if (Middle.load() & FRESH)
+            Front = Middle.exchange(Front) & 3;
+        return Buffer[Front];
+    }
+
+    // Steps the configuration and publishes every generation
+    void Run() {
+        using namespace GameOfLife;
+        typedef std::chrono::steady_clock Clock;
+        auto next = Clock::now(), last = next;
+        while (Running) {
+            if (Paused) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                next = last = Clock::now();
+                Rate = 0.;
+                continue;
+            }
+            if (Step != STEP) SetStep(Step);
+            try { NextGeneration(); }
+            catch (const std::length_error &e) {
+                // Hold the last generation that fit under the cap
+                cout << e.what() << endl;
+                Paused = true;
+                continue;
+            }
+            // Smooth the rate over the steps of about the last second
+            auto stepped = Clock::now();
+            double seconds = std::chrono::duration<double>(stepped - last).count();
+            last = stepped;
+            if (seconds > 0.) {
+                double weight = std::min(seconds, 1.);
+                Rate = Rate * (1. - weight) + weight * double(uint64_t(1) << STEP) / seconds;
+            }
+            Publish();
+            // Wait long enough to keep to the target speed, but step at
+            // least once a second so a big step is not held back for long
+            double speed = Speed;
+            if (speed <= 0.) continue;
+            double wait = std::min(double(uint64_t(1) << STEP) / speed, 1.);
+            next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(wait));
+            auto now = Clock::now();
+            if (next < now) next = now;     // Do not race to catch up
+            else std::this_thread::sleep_until(next);
+        }
+    }
+
+    // Starts the worker from the loaded configuration
+    void Start() {
+        using namespace GameOfLife;
+        for (_QSnapshot_ &b : Buffer)
+            b = {Configuration, GENERATION, STEP, CacheHitRate(), MemoryUsage(),
+                 NodeList.size() - FreeCount, 0.};
+        Snapshots = {Configuration};
+        Step = STEP;
+        Running = true;
+        Worker = std::thread(Run);
+    }
+
+    void Stop() {
+        Running = false;
+        if (Worker.joinable()) Worker.join();
+    }
+}
+
+#ifndef HEADLESS
+namespace Text {
+    struct _QLabel_ {
+        SDL_Texture *texture = NULL;
+        int w = 0, h = 0;
+    };
+
+    TTF_Font *Font = NULL;
+    SDL_Color TextColor = {255, 255, 255, 255};
+    // Textures of the text between the numbers, which rarely changes
+    map<string, _QLabel_> Labels;
+    // A single texture with the digits 0 to 9 and where each one sits
+    _QLabel_ Digits;
+    SDL_Rect DigitRects[10] = {};
+
+    // Renders a message to its own texture
+    _QLabel_ NewLabel(SDL_Renderer *renderer, const string &msg) {
+        _QLabel_ label;
+        SDL_Surface *surface = TTF_RenderText_Solid(Font, msg.c_str(), TextColor);
+        if (!surface) {
+            cout << TTF_GetError() << endl;
+            cout << "TTF unable to create surface" << endl;
+            return label;
+        }
+        label.texture = SDL_CreateTextureFromSurface(renderer, surface);
+        if (!label.texture) {
+            cout << TTF_GetError() << endl;
+            cout << "TTF unable to create texture" << endl;
+        }
+        label.w = surface->w;
+        label.h = surface->h;
+        SDL_FreeSurface(surface);
+        return label;
+    }
+
+    // Opens the font once and builds the digit atlas
+    void Init(SDL_Renderer *renderer) {
+        TTF_Init();
+        Font = TTF_OpenFont("./fonts/07558_CenturyGothic.ttf", 12);
+        if (!Font) {
+            cout << TTF_GetError() << endl;
+            cout << "TTF font unloaded" << endl;
+            return;
+        }
+        string digits = "0123456789";
+        Digits = NewLabel(renderer, digits);
+        for (int d = 0, x = 0; d < 10; d++) {
+            // The width of the digits so far gives the edge of the next one
+            int w = 0, h = 0;
+            TTF_SizeText(Font, digits.substr(0, d + 1).c_str(), &w, &h);
+            DigitRects[d] = {x, 0, w - x, Digits.h};
+            x = w;
+        }
+    }
+
+    // Draws the message from cached labels and the digit atlas,
+    // so no texture is created unless the text between numbers changes
+    void RenderText(SDL_Renderer *renderer, string msg, int x = 0, int y = 0) {
+        if (!Font) return;
+        for (int start = 0, end = 0; start < msg.length(); start = end) {
+            bool digit = isdigit(msg[start]);
+            while (end < msg.length() && bool(isdigit(msg[end])) == digit) end++;
+            if (digit) {
+                for (int c = start; c < end; c++) {
+                    SDL_Rect &src = DigitRects[msg[c] - '0'];
+                    SDL_Rect dst = {x, y, src.w, src.h};
+                    SDL_RenderCopy(renderer, Digits.texture, &src, &dst);
+                    x += src.w;
+                }
+                continue;
+            }
+            string text = msg.substr(start, end - start);
+            if (Labels.find(text) == Labels.end()) {
+                // Drop the labels once too many different ones were made
+                if (Labels.size() > 64) {
+                    for (auto &[k, label] : Labels)
+                        SDL_DestroyTexture(label.texture);
+                    Labels.clear();
+                }
+                Labels[text] = NewLabel(renderer, text);
+            }
+            _QLabel_ &label = Labels[text];
+            SDL_Rect dst = {x, y, label.w, label.h};
+            SDL_RenderCopy(renderer, label.texture, NULL, &dst);
+            x += label.w;
+        }
+    }
+
+    void Quit() {
+        for (auto &[k, label] : Labels)
+            SDL_DestroyTexture(label.texture);
+        Labels.clear();
+        SDL_DestroyTexture(Digits.texture);
+        Digits = {};
+        if (Font) TTF_CloseFont(Font);
+        Font = NULL;
+        TTF_Quit();
+    }
+}
+
+namespace STATUS {
+    SDL_Point gridpos;
+    SDL_Point mousepos;
+    stringstream stream;
+    string mousewhere = "";
+    SDL_Rect ViewPort = {0, HEIGHT - 20, WIDTH, 20};
+
+    void RenderStatus(SDL_Renderer *renderer, const Simulation::_QSnapshot_ &view) {
+        SDL_RenderSetViewport(renderer, &ViewPort);
+
+        stream.str(string()); // Clear the stream
         // Add the grid coordinates
         stream << "x: " << gridpos.x << ", ";
         stream << "y: " << gridpos.y;
         // Add a tab after the grid coordinates
         stream << "  |  ";
-        stream << "Generation: " << GameOfLife::GENERATION;
+        stream << "Generation: " << view.generation;
+        stream << "  |  ";
+        stream << "Step: 2^" << view.step;
+        stream << "  |  ";
+        stream << "Memo: " << int(view.memo * 100) << "%";
+        stream << "  |  ";
+        stream << "Memory: " << (view.bytes >> 20) << " MB";
+        stream << "  |  ";
+        stream << "Nodes: " << view.nodes;
+        stream << "  |  ";
+        stream << "Rate: " << lround(view.rate) << " gen/s";
+        stream << "  |  ";
+        if (Simulation::Paused) stream << "Paused";
+        else stream << "Speed: " << Simulation::Speed << " gen/s";
         Text::RenderText(renderer, stream.str());
     }
+
+    bool overlay = true;        // Show the frame time over the grid
+    double frametime = 0.;      // Smoothed time to draw a frame in ms
+
+    // Adds a frame to the smoothed frame time
+    void AddFrame(double ms) {
+        frametime = (frametime == 0.) ? ms : frametime * 0.95 + ms * 0.05;
+    }
+
+    // Draws the frame time in the top corner of the grid, and the
+    // timers and counters under it when they are compiled in
+    void RenderOverlay(SDL_Renderer *renderer, const SDL_Rect &viewport) {
+        if (!overlay) return;
+        SDL_RenderSetViewport(renderer, &viewport);
+        // A stream of its own, so the status line keeps its formatting
+        stringstream frame;
+        frame << "Frame: " << std::fixed;
+        frame.precision(2);
+        frame << frametime << " ms";
+        Text::RenderText(renderer, frame.str(), 4, 4);
+        if (!Profile::ENABLED) return;
+        int y = 24;
+        for (const string &line : Profile::Rates()) {
+            Text::RenderText(renderer, line, 4, y);
+            y += 20;
+        }
+    }
 }
 
 namespace CAM {
     int zoom = 0;
+    const int MIN_ZOOM = -21;         // A pixel holds at most 2^20 cells
     int ppc = zoom + 1.;              // Pixel per cell
     int pps = zoom + 2.;              // Pixel per skip
+    double scale = pps;               // Pixel per cell, below 1 when zoomed out
     int block = 10 + (ppc * 10);      // Size of cells 1 to 10
     SDL_Rect Cell = {0, 0, pps, pps}; // The rect of a single cell
     SDL_Rect ViewPort = {0, 0, WIDTH, HEIGHT - 20};
@@ -808,11 +3073,17 @@ namespace CAM {
     float scale_w = ceil(float(mid::w - 1.) / block);
     float scale_h = ceil(float(mid::h - 1.) / block);
 
+    // Below zoom 0 every step halves the pixels per cell
     void Recalculate() {
-        ppc = zoom + 1;
-        pps = zoom + 2.;
+        double previous = scale;
+        scale = (zoom >= 0) ? zoom + 2. : pow(2., zoom + 1);
+        ppc = std::max(zoom + 1, 1);
+        pps = std::max(zoom + 2, 1);
         block = 10 + (ppc * 10);
         Cell.w = pps, Cell.h = pps;
+        // Keep the center of the view on the same cell
+        position::x = lround(position::x * scale / previous);
+        position::y = lround(position::y * scale / previous);
     }
     void ZoomIn() {
         zoom++;
@@ -821,78 +3092,105 @@ namespace CAM {
     }
     void ZoomOut() {
         zoom--;
-        zoom = (zoom < 0)? 0: zoom;
+        zoom = (zoom < MIN_ZOOM)? MIN_ZOOM: zoom;
         Recalculate();
     }
 
     SDL_Point GetGridCoordinates(const SDL_Point &mpos) {
-        float x = float(mpos.x - mid::w - position::x) / pps;
-        float y = float(mid::h + position::y - mpos.y) / pps;
+        double x = double(mpos.x - mid::w - position::x) / scale;
+        double y = double(mid::h + position::y - mpos.y) / scale;
         return {
             int(x + ((x < 0) ? -1 : 1)),
             int(y + ((y < 0) ? -1 : 1))
         };
     }
 
-    void RenderGrid(SDL_Renderer *renderer) {
+    // Nodes smaller than a pixel are drawn as one pixel shaded by density
+    const int SHADES = 8;
+    std::vector<SDL_Rect> Cells;
+    std::vector<SDL_Point> Pixels[SHADES];
+
+    // Collects the live cells of a node that overlap the viewport.
+    // The node covers the cells [x, x + 2^depth) and [y, y + 2^depth)
+    // of the world, whose origin is drawn at (ox, oy).
+    void CollectNode(GameOfLife::node_t node, int64_t x, int64_t y, double ox, double oy) {
+        const GameOfLife::_QTreeNode_ &n = GameOfLife::NodeList[node];
+        if (n.area == 0) return;
+        double size = std::ldexp(scale, n.depth);
+        double sx = ox + x * scale, sy = oy + y * scale;
+        // Skip the nodes outside of the viewport
+        if (sx >= ViewPort.w || sy >= ViewPort.h) return;
+        if (sx + size <= 0 || sy + size <= 0) return;
+        if (n.depth == 0) {
+            // A single cell, leaving the grid lines visible
+            int w = (pps > 1) ? pps - 1 : 1;
+            Cells.push_back({int(floor(sx)), int(floor(sy)), w, w});
+            return;
+        }
+        if (size <= 1.) {
+            double density = n.area / std::ldexp(1., 2 * n.depth);
+            int shade = std::min(int(sqrt(density) * SHADES), SHADES - 1);
+            Pixels[shade].push_back({int(floor(sx)), int(floor(sy))});
+            return;
+        }
+        int64_t half = int64_t(1) << (n.depth - 1);
+        CollectNode(n.nw, x, y, ox, oy);
+        CollectNode(n.ne, x + half, y, ox, oy);
+        CollectNode(n.sw, x, y + half, ox, oy);
+        CollectNode(n.se, x + half, y + half, ox, oy);
+    }
+
+    void RenderGrid(SDL_Renderer *renderer, GameOfLife::node_t root) {
+        PROFILE_SCOPE("RenderGrid");
         SDL_RenderSetViewport(renderer, &ViewPort);
 
-        // Calculating starting points, wrap around the block
-        float start_w = mid::w - (scale_w * block) - 1;
-        start_w = start_w + (position::x % block);
-        start_w -= (start_w > 0) ? ceil(start_w / block) * block : 0;
+        // Grid lines only make sense while a cell is a few pixels wide
+        if (zoom >= 0) {
+            // Calculating starting points, wrap around the block
+            float start_w = mid::w - (scale_w * block) - 1;
+            start_w = start_w + (position::x % block);
+            start_w -= (start_w > 0) ? ceil(start_w / block) * block : 0;
 
-        float start_h = mid::h - (scale_h * block) - 1;
-        start_h = start_h + (position::y % block);
-        start_h -= (start_h > 0) ? ceil(start_h / block) * block : 0;
+            float start_h = mid::h - (scale_h * block) - 1;
+            start_h = start_h + (position::y % block);
+            start_h -= (start_h > 0) ? ceil(start_h / block) * block : 0;
 
-        // Curtain Sweep: Width and Height
-        SDL_SetRenderDrawColor(renderer, 63, 63, 63, 255);
-        for (int w = start_w; w < ViewPort.w; w = w + pps) {
-            if (w < 0) continue;
-            SDL_RenderDrawLine(renderer, w, 0, w, ViewPort.h - 1);
-        }
-        for (int h = start_h; h < ViewPort.h; h = h + pps) {
-            if (h < 0) continue;
-            SDL_RenderDrawLine(renderer, 0, h, ViewPort.w - 1, h);
-        }
+            // Curtain Sweep: Width and Height
+            SDL_SetRenderDrawColor(renderer, 63, 63, 63, 255);
+            for (int w = start_w; w < ViewPort.w; w = w + pps) {
+                if (w < 0) continue;
+                SDL_RenderDrawLine(renderer, w, 0, w, ViewPort.h - 1);
+            }
+            for (int h = start_h; h < ViewPort.h; h = h + pps) {
+                if (h < 0) continue;
+                SDL_RenderDrawLine(renderer, 0, h, ViewPort.w - 1, h);
+            }
 
-        // Curtain Sweep: Highlights
-        SDL_SetRenderDrawColor(renderer, 127, 127, 127, 255);
-        for (int w = start_w; w < ViewPort.w; w = w + block) {
-            if (w < 0) continue;
-            SDL_RenderDrawLine(renderer, w, 0, w, ViewPort.h - 1);
-        }
-        for (int h = start_h; h < ViewPort.h; h = h + block) {
-            if (h < 0) continue;
-            SDL_RenderDrawLine(renderer, 0, h, ViewPort.w - 1, h);
+            // Curtain Sweep: Highlights
+            SDL_SetRenderDrawColor(renderer, 127, 127, 127, 255);
+            for (int w = start_w; w < ViewPort.w; w = w + block) {
+                if (w < 0) continue;
+                SDL_RenderDrawLine(renderer, w, 0, w, ViewPort.h - 1);
+            }
+            for (int h = start_h; h < ViewPort.h; h = h + block) {
+                if (h < 0) continue;
+                SDL_RenderDrawLine(renderer, 0, h, ViewPort.w - 1, h);
+            }
         }
 
         // Curtian Sweep: Fill Cell
+        // Descend the quadtree only where it is alive and on screen
+        Cells.clear();
+        for (auto &pixels : Pixels) pixels.clear();
+        Vector2D<int64_t> origin = GameOfLife::Origin(root);
+        CollectNode(root, origin.x, origin.y, mid::w + position::x, mid::h + position::y);
+
         SDL_SetRenderDrawColor(renderer, 220, 220, 220, 255);
-        auto config = GameOfLife::ReadConfigurationAsMap();
-        auto sy = config.size.y, sx = config.size.x; // Size of the array
-        auto hy = sy / 2, hx = sx / 2;               // Half size
-        for (int h = start_h; h < ViewPort.h; h = h + pps) {
-            for (int w = start_w; w < ViewPort.w; w = w + pps) {
-                if (w < 0 || h < 0) continue;
-                // Convert the position to grid coordinates
-                SDL_Point cell = GetGridCoordinates({w, h});
-                // Convert the coordinates to array position
-                Vector2D acell = {
-                    hx + cell.x - ((cell.x < 0) ? 0 : 1),
-                    hy - cell.y - ((cell.y > 0) ? 0 : 1)};
-                // Make sure they are within the size of the array
-                if (acell.x < 0 || acell.x >= sx) continue;
-                if (acell.y < 0 || acell.y >= sy) continue;
-                // Check if the cell of the array contains a ONE
-                if (!config.find(acell.y, acell.x)) continue;
-                if (config.array[acell.y][acell.x] == ONE) {
-                    Cell.y = h - pps; // Fill the information in the Cell rect obj...
-                    Cell.x = w - pps; // at the current pointer to the grid(w, h)
-                    SDL_RenderFillRect(renderer, &Cell);
-                }
-            }
+        SDL_RenderFillRects(renderer, Cells.data(), Cells.size());
+        for (int shade = 0; shade < SHADES; shade++) {
+            Uint8 c = 60 + (160 * (shade + 1)) / SHADES;
+            SDL_SetRenderDrawColor(renderer, c, c, c, 255);
+            SDL_RenderDrawPoints(renderer, Pixels[shade].data(), Pixels[shade].size());
         }
     }
 
@@ -905,31 +3203,137 @@ string FindViewPort() {
         return "STATUS";
     return "";
 }
+#endif
 
 int main(int argc, char **argv) {
+#ifdef BENCHMARK
+    // The benchmark build only runs the suite
+    return Benchmark::Suite((argc > 1) ? argv[1] : "benchmark.tsv");
+#endif
+#ifdef HEADLESS
+    bool headless = true;               // Built without SDL
+#else
+    bool headless = false;              // Run without opening a window
+#endif
+    string config = "./[configuration]", pattern = "", load = "", save = "", trace = "", scaling = "";
+    string benchmark = "";              // The benchmark to run instead of the application
+    uint64_t generations = 0, until = 0;
+    int step = GameOfLife::MAX_STEP, threads = 1;
+    long int nodes = 1 << 22;           // Nodes for --benchmark to create
+    bool stepped = false;               // Given a step on the command line
+    bool threaded = false;              // Given a thread count on the command line
+    std::vector<string> batch;          // Configurations and directories to run together
+    // Whether an optional value follows at x, and whether it is a count
+    auto value = [&](int x) { return x < argc && string(argv[x]).rfind("--", 0) != 0; };
+    auto count = [&](int x) {
+        return value(x) && string(argv[x]).find_first_not_of("0123456789") == string::npos;
+    };
+    // Names the bad argument and exits with a usage error
+    auto usage = [&](string problem) {
+        cout << problem << endl;
+        cout << "Usage: " << argv[0] << " [--headless] [--config <file> | --pattern <file> | --load <file>]"
+             << " [--generations N] [--step K] ..., see README.md for every option" << endl;
+        return 2;
+    };
+    for (int x = 1; x < argc; x++) {
+        string arg = argv[x];
+        if (arg == "--headless") headless = true;
+        else if (arg == "--detect") Headless::Detect = true;
+        else if (arg == "--verbose") GameOfLife::VerboseGC = true;
+        // Maybe the nodes to create
+        else if (arg == "--benchmark") {
+            benchmark = arg;
+            if (count(x + 1)) nodes = std::stol(argv[++x]);
+        }
+        // The configuration to report the memo hits of or time the leaf
+        // kernel on, unless a --pattern is given, then maybe the generations
+        else if (arg == "--benchmark-memo" || arg == "--benchmark-kernel") {
+            benchmark = arg;
+            if (value(x + 1) && !count(x + 1)) config = argv[++x];
+            if (count(x + 1)) generations = std::stoull(argv[++x]);
+        }
+        // The rest take a value
+        else if (x + 1 == argc) return usage("Unknown option or missing value: " + arg);
+        else if (arg == "--config") config = argv[++x];
+        else if (arg == "--pattern") pattern = argv[++x];
+        else if (arg == "--load") load = argv[++x];
+        else if (arg == "--save") save = argv[++x];
+        else if (arg == "--trace") trace = argv[++x];
+        else if (arg == "--batch") batch.push_back(argv[++x]);
+        // The configuration to time on more and more threads, then maybe
+        // the generations to step
+        else if (arg == "--benchmark-threads") {
+            scaling = argv[++x];
+            if (count(x + 1)) generations = std::stoull(argv[++x]);
+        }
+        else if (arg == "--checkpoint") Headless::Checkpoint = argv[++x];
+        else if (arg == "--checkpoint-every") Headless::CheckpointEvery = std::stoull(argv[++x]);
+        else if (arg == "--checkpoint-seconds") Headless::CheckpointSeconds = std::stod(argv[++x]);
+        else if (arg == "--generations") generations = std::stoull(argv[++x]);
+        else if (arg == "--until") until = std::stoull(argv[++x]);
+        else if (arg == "--step") step = std::stoi(argv[++x]), stepped = true;
+        else if (arg == "--speed") Simulation::Speed = std::stod(argv[++x]);
+        // Sets the memory budget of the node table in megabytes
+        else if (arg == "--memory") GameOfLife::MemoryBudget = std::stol(argv[++x]) << 20;
+        // Stops the run instead of going over this many megabytes
+        else if (arg == "--memory-cap") GameOfLife::MemoryCap = std::stol(argv[++x]) << 20;
+        else if (arg == "--threads") threads = std::stoi(argv[++x]), threaded = true;
+        // Nodes deeper than this split their subproblems over the threads
+        else if (arg == "--parallel-depth") GameOfLife::ParallelDepth = std::stoi(argv[++x]);
+        else return usage("Unknown argument: " + arg);
+    }
+    // Steps every configuration given together on a shared table, on the
+    // threads given or else on every core
+    if (!batch.empty())
+        return Batch::Run(batch, generations ? generations : 1024, std::min(step, GameOfLife::MAX_STEP),
+                          threaded ? threads : std::max(1, int(std::thread::hardware_concurrency())));
+    // Times the step on more and more threads, up to the cores unless given
+    if (scaling != "") {
+        int most = threaded ? threads : std::max(1, int(std::thread::hardware_concurrency()));
+        Benchmark::Threads(scaling, generations ? generations : 1 << 20, most);
+        return 0;
+    }
+    GameOfLife::SetThreads(threads);
+    // Records the timed scopes for the trace written at exit
+    if (trace != "" && !Profile::ENABLED)
+        cout << "--trace records nothing without -DPROFILE" << endl;
+    Profile::Tracing = (trace != "" && Profile::ENABLED);
+    // Runs the node table benchmark instead of the application
+    if (benchmark == "--benchmark") {
+        Benchmark::NodeCreation(nodes);
+        return 0;
+    }
+    // Runs a configuration and reports how often the memo hits
+    if (benchmark == "--benchmark-memo") {
+        Benchmark::MemoCache(pattern != "" ? pattern : config, pattern == "", generations ? generations : 600, 30);
+        return 0;
+    }
+    // Compares the leaf kernel with the TheRules base case
+    if (benchmark == "--benchmark-kernel") {
+        Benchmark::Kernel(pattern != "" ? pattern : config, pattern == "", generations ? generations : 1000);
+        return 0;
+    }
     cout << "始まる..." << endl;
-    // GAME OF LIFE: Initialise Canonical values
-    cout << "「Basic Canonical Nodes」って言う物を作る" << endl;
-    GameOfLife::NewNode(0, 0, 0, 0);
-    GameOfLife::NewNode(0, 0, 0, 1);
-    GameOfLife::NewNode(0, 0, 1, 0);
-    GameOfLife::NewNode(0, 0, 1, 1);
-    GameOfLife::NewNode(0, 1, 0, 0);
-    GameOfLife::NewNode(0, 1, 0, 1);
-    GameOfLife::NewNode(0, 1, 1, 0);
-    GameOfLife::NewNode(0, 1, 1, 1);
-    GameOfLife::NewNode(1, 0, 0, 0);
-    GameOfLife::NewNode(1, 0, 0, 1);
-    GameOfLife::NewNode(1, 0, 1, 0);
-    GameOfLife::NewNode(1, 0, 1, 1);
-    GameOfLife::NewNode(1, 1, 0, 0);
-    GameOfLife::NewNode(1, 1, 0, 1);
-    GameOfLife::NewNode(1, 1, 1, 0);
-    GameOfLife::NewNode(1, 1, 1, 1);
+    // Read the patterns of ./src/ while the rest starts up
+    if (load == "" && pattern == "") GameOfLife::IndexLibrary();
     // Load the .configuration pattern
     cout << "「[configuration]」って言うファイルを読み込む" << endl;
-    GameOfLife::Load_Config_To_Node("./[configuration]");
+    if (load != "") GameOfLife::Load_Snapshot_To_Node(load);
+    else if (pattern != "") GameOfLife::Load_Pattern_To_Node(pattern);
+    else GameOfLife::Load_Config_To_Node(config);
+    if (headless) {
+        // A checkpoint file without an interval is refreshed every minute
+        if (Headless::Checkpoint != "" && !Headless::CheckpointEvery && Headless::CheckpointSeconds <= 0.)
+            Headless::CheckpointSeconds = 60.;
+        // Detection compares states a step apart, so keep the steps short
+        if (Headless::Detect && !stepped) step = Headless::DETECT_STEP;
+        int status = Headless::Run(std::max(until, GameOfLife::GENERATION + generations), step);
+        if (save != "") GameOfLife::Save_Snapshot(save, GameOfLife::Configuration, GameOfLife::GENERATION);
+        if (Profile::Tracing) Profile::WriteTrace(trace);
+        return status;
+    }
 
+#ifndef HEADLESS
     // Initialise Simple Direct Media Layer
     cout << "「SDL」を始める" << endl;
     SDL_Init(SDL_INIT_VIDEO);
@@ -941,9 +3345,15 @@ int main(int argc, char **argv) {
         SDL_WINDOW_BORDERLESS
     );
     SDL_Renderer *renderer = SDL_CreateRenderer(
-        window, -1, SDL_RENDERER_ACCELERATED
+        window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
     );
 
+    Text::Init(renderer);
+
+    // Life is computed on its own thread from here on
+    GameOfLife::SetStep(0);
+    Simulation::Start();
+
     // The Application Loop ---------------------------------------------------
     SDL_Event event;
     bool QUIT = false, MOUSE1_PRIMED = false;
@@ -953,6 +3363,11 @@ int main(int argc, char **argv) {
         while(SDL_PollEvent(&event) != 0) {
             if (event.type == SDL_QUIT) QUIT = true;
             else if (event.type == SDL_MOUSEMOTION) {
+                // Drag with the left button to pan the view
+                if (event.motion.state & SDL_BUTTON_LMASK) {
+                    CAM::position::x += event.motion.xrel;
+                    CAM::position::y += event.motion.yrel;
+                }
                 STATUS::mousepos = {event.motion.x, event.motion.y};
                 STATUS::mousewhere = FindViewPort();
                 STATUS::gridpos = CAM::GetGridCoordinates(STATUS::mousepos);
@@ -987,31 +3402,54 @@ int main(int argc, char **argv) {
                 else if (event.key.keysym.sym == SDLK_UP) CAM::position::y -= 1;
                 else if (event.key.keysym.sym == SDLK_DOWN) CAM::position::y += 1;
                 else if (event.key.keysym.sym == SDLK_RIGHT) CAM::position::x += 1;
+                // Change how many generations each step advances
+                else if (event.key.keysym.sym == SDLK_EQUALS)
+                    Simulation::Step = std::min(Simulation::Step + 1, GameOfLife::MAX_STEP);
+                else if (event.key.keysym.sym == SDLK_MINUS)
+                    Simulation::Step = std::max(Simulation::Step - 1, 0);
+                // Show or hide the frame time
+                else if (event.key.keysym.sym == SDLK_f) STATUS::overlay = !STATUS::overlay;
+                // Pause, slow down or speed up the simulation
+                else if (event.key.keysym.sym == SDLK_SPACE) Simulation::Paused = !Simulation::Paused;
+                else if (event.key.keysym.sym == SDLK_LEFTBRACKET)
+                    Simulation::Speed = std::max(Simulation::Speed / 2., 1.);
+                else if (event.key.keysym.sym == SDLK_RIGHTBRACKET)
+                    Simulation::Speed = Simulation::Speed * 2.;
             }
         }
 
         // Rendering to Window ------------------------------------------------
+        PROFILE_SCOPE("Frame");
+        Uint64 frame = SDL_GetPerformanceCounter();
+        // Pick up the latest generation from the simulation
+        const Simulation::_QSnapshot_ &view = Simulation::Acquire();
         // Wipe the renderer w black
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
         // Draw the grid and the ALIVE pixels
-        CAM::RenderGrid(renderer);
+        CAM::RenderGrid(renderer, view.root);
         // Show status.. idk.!!
-        STATUS::RenderStatus(renderer);
+        STATUS::RenderStatus(renderer, view);
+        STATUS::RenderOverlay(renderer, CAM::ViewPort);
+        // Time the drawing, leaving out the wait for vsync
+        frame = SDL_GetPerformanceCounter() - frame;
+        STATUS::AddFrame(1000. * frame / SDL_GetPerformanceFrequency());
 
         // Present render to Window
         SDL_RenderPresent(renderer);
-
-        // Compute the next generation of Life
-        GameOfLife::NextGeneration();
     }
     cout << "[出っている: Application Loop]" << endl;
+    Simulation::Stop();
+    GameOfLife::PrintCollections();
+    if (save != "") GameOfLife::Save_Snapshot(save, GameOfLife::Configuration, GameOfLife::GENERATION);
+    if (Profile::Tracing) Profile::WriteTrace(trace);
 
     // cleanup SDL
     Text::Quit();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
+#endif
 
     return 0;
 }